@@ -1,37 +1,132 @@
+#pragma once
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
-#include <future>
 #include <map>
-#include <numeric>
-#include <random>
 #include <mutex>
-#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <execution>
 
+// Хеш-таблица с открытой адресацией, разбитая на независимые полосы (stripes).
+// Каждая полоса защищена своим мьютексом и выровнена по кэш-линии, чтобы соседние мьютексы не делили одну линию.
 template <typename Key, typename Value>
 class ConcurrentMap
 {
 private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    static constexpr size_t MIN_STRIPE_CAPACITY = 16;
 
-    struct Bucket
+    enum class SlotState : char
+    {
+        EMPTY,
+        FULL,
+        ERASED,
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Stripe
     {
-        std::map<Key, Value> dict;
         std::mutex m;
+        std::vector<Key> keys;
+        std::vector<Value> values;
+        std::vector<SlotState> states;
+        size_t size = 0;
+        size_t used = 0;    // занятые и удалённые ячейки: от них зависит длина проб
     };
 
-    std::vector<Bucket> buckets;
+    std::vector<Stripe> stripes_;
+
+    static uint64_t Hash(const Key& key)
+    {
+        // перемешивание splitmix64: последовательные ключи не должны попадать в соседние ячейки одной полосы
+        uint64_t x = static_cast<uint64_t>(key) + 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
 
-    uint64_t GetDictionaryNumber(const Key& key)
+    Stripe& GetStripe(uint64_t hash)
     {
-        return static_cast<uint64_t>(key) % buckets.size();
+        return stripes_[(hash >> 32) % stripes_.size()];
+    }
+
+    // Возвращает ячейку с ключом или ячейку, куда его можно вставить. Таблица полосы не бывает заполнена целиком.
+    static size_t FindCell(const Stripe& stripe, const Key& key, uint64_t hash)
+    {
+        const size_t mask = stripe.states.size() - 1;
+        size_t free_cell = stripe.states.size();
+        for (size_t cell = hash & mask;; cell = (cell + 1) & mask)
+        {
+            const SlotState state = stripe.states[cell];
+            if (state == SlotState::EMPTY)
+            {
+                return free_cell != stripe.states.size() ? free_cell : cell;
+            }
+            if (state == SlotState::ERASED)
+            {
+                if (free_cell == stripe.states.size())
+                {
+                    free_cell = cell;
+                }
+            }
+            else if (stripe.keys[cell] == key)
+            {
+                return cell;
+            }
+        }
+    }
+
+    static void Rehash(Stripe& stripe, size_t capacity)
+    {
+        std::vector<Key> keys(capacity);
+        std::vector<Value> values(capacity);
+        std::vector<SlotState> states(capacity, SlotState::EMPTY);
+        std::swap(stripe.keys, keys);
+        std::swap(stripe.values, values);
+        std::swap(stripe.states, states);
+        stripe.used = stripe.size;
+
+        for (size_t cell = 0; cell < states.size(); ++cell)
+        {
+            if (states[cell] == SlotState::FULL)
+            {
+                const size_t new_cell = FindCell(stripe, keys[cell], Hash(keys[cell]));
+                stripe.keys[new_cell] = keys[cell];
+                stripe.values[new_cell] = std::move(values[cell]);
+                stripe.states[new_cell] = SlotState::FULL;
+            }
+        }
+    }
+
+    static Value& FindOrInsert(Stripe& stripe, const Key& key, uint64_t hash)
+    {
+        // заполненность держим не выше 3/4, учитывая удалённые ячейки
+        if (stripe.states.empty() || (stripe.used + 1) * 4 > stripe.states.size() * 3)
+        {
+            const size_t capacity = std::max(MIN_STRIPE_CAPACITY, stripe.states.size());
+            Rehash(stripe, (stripe.size + 1) * 2 > capacity ? capacity * 2 : capacity);
+        }
+
+        const size_t cell = FindCell(stripe, key, hash);
+        if (stripe.states[cell] != SlotState::FULL)
+        {
+            if (stripe.states[cell] == SlotState::EMPTY)
+            {
+                ++stripe.used;
+            }
+            stripe.keys[cell] = key;
+            stripe.values[cell] = Value();
+            stripe.states[cell] = SlotState::FULL;
+            ++stripe.size;
+        }
+        return stripe.values[cell];
     }
 
 public:
     static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys");
 
     explicit ConcurrentMap(size_t bucket_count)
-        : buckets(bucket_count){}
+        : stripes_(std::max<size_t>(bucket_count, 1)){}
 
     struct Access
     {
@@ -41,33 +136,59 @@ public:
 
     Access operator[](const Key& key)
     {
-        const uint64_t dict_cnt = GetDictionaryNumber(key);
-
-            auto& bucket = buckets[dict_cnt];
+        const uint64_t hash = Hash(key);
+        auto& stripe = GetStripe(hash);
 
-        return Access{ std::lock_guard<std::mutex>(bucket.m), bucket.dict[key] };
+        std::unique_lock<std::mutex> lock(stripe.m);
+        Value& value = FindOrInsert(stripe, key, hash);
+        lock.release();
+        return Access{ std::lock_guard<std::mutex>(stripe.m, std::adopt_lock), value };
     }
 
-    void erase(const Key& key) // в слаке подсказали в обсуждении! Без erase не получится.
+    void erase(const Key& key)
     {
-        const uint64_t dict_cnt = GetDictionaryNumber(key);
-        auto& bucket = buckets[dict_cnt];
-        std::lock_guard<std::mutex> guard(bucket.m);
+        const uint64_t hash = Hash(key);
+        auto& stripe = GetStripe(hash);
+        std::lock_guard<std::mutex> guard(stripe.m);
+
+        if (stripe.states.empty())
+        {
+            return;
+        }
+        const size_t cell = FindCell(stripe, key, hash);
+        if (stripe.states[cell] == SlotState::FULL)
+        {
+            stripe.states[cell] = SlotState::ERASED;
+            stripe.values[cell] = Value();
+            --stripe.size;
+        }
+    }
 
-        bucket.dict.erase(key);
+    // Выгрузка всех пар без упорядочивания.
+    std::vector<std::pair<Key, Value>> BuildOrdinaryVector()
+    {
+        std::vector<std::pair<Key, Value>> result;
+        for (auto& stripe : stripes_)
+        {
+            std::lock_guard<std::mutex> guard(stripe.m);
+            for (size_t cell = 0; cell < stripe.states.size(); ++cell)
+            {
+                if (stripe.states[cell] == SlotState::FULL)
+                {
+                    result.emplace_back(stripe.keys[cell], stripe.values[cell]);
+                }
+            }
+        }
+        return result;
     }
 
     std::map<Key, Value> BuildOrdinaryMap()
     {
         std::map<Key, Value> MergedMap;
-
-        for (size_t i = 0; i < buckets.size(); ++i)
+        for (auto& [key, value] : BuildOrdinaryVector())
         {
-            auto& bucket = buckets[i];
-            std::lock_guard<std::mutex> guard(bucket.m);
-            MergedMap.merge(bucket.dict);
+            MergedMap.emplace(key, std::move(value));
         }
-
         return MergedMap;
     }
 };
@@ -0,0 +1,126 @@
+#include "concurrent_search_server.h"
+
+//--------------------ConcurrentSearchServer::Snapshot------------------//
+ConcurrentSearchServer::Snapshot::Snapshot(EpochReclaimer<Generation>::Guard guard, const Generation* generation,
+                                           const FrozenStringSet* stop_words)
+    : guard_(std::move(guard)), generation_(generation), stop_words_(stop_words){}
+
+std::vector<Document> ConcurrentSearchServer::Snapshot::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t top_k) const
+{
+    return FindTopDocuments(raw_query, StatusIs{ status }, top_k);
+}
+
+std::vector<Document> ConcurrentSearchServer::Snapshot::FindTopDocuments(std::string_view raw_query) const
+{
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ConcurrentSearchServer::Snapshot::MatchDocument(std::string_view raw_query,
+                                                                                                         int document_id) const
+{
+    const auto& shards = generation_->shards;
+    return shards[static_cast<unsigned>(document_id) % shards.size()]->MatchDocument(raw_query, document_id);
+}
+
+size_t ConcurrentSearchServer::Snapshot::GetDocumentCount() const
+{
+    size_t document_count = 0;
+    for (const auto& shard : generation_->shards)
+    {
+        document_count += shard->GetDocumentCount();
+    }
+    return document_count;
+}
+
+uint64_t ConcurrentSearchServer::Snapshot::GetGeneration() const
+{
+    return generation_->number;
+}
+
+//--------------------ConcurrentSearchServer------------------//
+ConcurrentSearchServer::ConcurrentSearchServer(size_t shard_count, const std::string& stop_words)
+    : ConcurrentSearchServer(shard_count, SplitIntoWords(stop_words)){}
+
+ConcurrentSearchServer::ConcurrentSearchServer(size_t shard_count)
+    : ConcurrentSearchServer(shard_count, std::vector<std::string_view>{}){}
+
+ConcurrentSearchServer::~ConcurrentSearchServer()
+{
+    // к этому моменту снимков уже нет, отложенные поколения освобождает reclaimer_
+    delete current_.load();
+}
+
+size_t ConcurrentSearchServer::GetShardIndex(int document_id) const
+{
+    return static_cast<unsigned>(document_id) % current_.load()->shards.size();
+}
+
+void ConcurrentSearchServer::Publish(std::unique_ptr<Generation> generation)
+{
+    const Generation* previous = current_.exchange(generation.release());
+    reclaimer_.Retire(std::unique_ptr<const Generation>(previous));
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
+{
+    std::lock_guard guard(write_mutex_);
+    auto generation = std::make_unique<Generation>(*current_.load());
+    ++generation->number;
+    const size_t shard_index = GetShardIndex(document_id);
+    auto shard = std::make_shared<SearchServer>(*generation->shards[shard_index]);
+    shard->AddDocument(document_id, document, status, ratings);
+    generation->shards[shard_index] = std::move(shard);
+    Publish(std::move(generation));
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id)
+{
+    std::lock_guard guard(write_mutex_);
+    const Generation& current = *current_.load();
+    const size_t shard_index = GetShardIndex(document_id);
+    // удаление отсутствующего документа не копирует шард и не порождает нового поколения
+    if (!current.shards[shard_index]->HasDocument(document_id))
+    {
+        return;
+    }
+    auto generation = std::make_unique<Generation>(current);
+    ++generation->number;
+    auto shard = std::make_shared<SearchServer>(*generation->shards[shard_index]);
+    shard->RemoveDocument(document_id);
+    generation->shards[shard_index] = std::move(shard);
+    Publish(std::move(generation));
+}
+
+ConcurrentSearchServer::Snapshot ConcurrentSearchServer::GetSnapshot() const
+{
+    // слот занимается до чтения указателя: поколение, прочитанное после этого, не будет освобождено
+    EpochReclaimer<Generation>::Guard guard = reclaimer_.Pin();
+    const Generation* generation = current_.load();
+    return Snapshot(std::move(guard), generation, &stop_words_);
+}
+
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t top_k) const
+{
+    return GetSnapshot().FindTopDocuments(raw_query, status, top_k);
+}
+
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(std::string_view raw_query) const
+{
+    return GetSnapshot().FindTopDocuments(raw_query);
+}
+
+size_t ConcurrentSearchServer::GetDocumentCount() const
+{
+    return GetSnapshot().GetDocumentCount();
+}
+
+uint64_t ConcurrentSearchServer::GetGeneration() const
+{
+    return GetSnapshot().GetGeneration();
+}
+
+size_t ConcurrentSearchServer::GetRetiredGenerationCount() const
+{
+    std::lock_guard guard(write_mutex_);
+    return reclaimer_.GetRetiredCount();
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include "document.h"
+#include "epoch_reclaimer.h"
+#include "frozen_string_set.h"
+#include "search_server.h"
+#include "sharded_search_server.h"
+#include "string_processing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Поисковый сервер, в котором поиск идёт одновременно с добавлением и удалением документов (MVCC).
+// Индекс - неизменяемое поколение из шардов SearchServer (документ лежит в шарде id mod числа шардов).
+// Читатель закрепляет текущее поколение и ищет в нём, не блокируясь на писателях. Писатель копирует только
+// затронутые шарды, меняет копии и атомарно публикует новое поколение; неизменённые шарды поколения делят.
+// Старые поколения освобождаются по эпохам, когда их не может видеть ни один читатель.
+// Цена записи - копия шарда, O(размер шарда) по времени и памяти, сколько бы документов ни менялось, поэтому
+// изменения выгодно собирать в пакеты (AddDocuments, RemoveDocuments) и держать шарды небольшими.
+class ConcurrentSearchServer
+{
+private:
+    struct Generation
+    {
+        uint64_t number;
+        std::vector<std::shared_ptr<const SearchServer>> shards;
+    };
+
+public:
+    // Закреплённое поколение: все поиски через него видят один и тот же набор документов.
+    // Пока снимок жив, его поколение не освобождается.
+    class Snapshot
+    {
+    public:
+        template <typename DocumentPredicate>
+        std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                               size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+        std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                               size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+        std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+        std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+        size_t GetDocumentCount() const;
+        uint64_t GetGeneration() const;
+
+    private:
+        friend class ConcurrentSearchServer;
+
+        EpochReclaimer<Generation>::Guard guard_;
+        const Generation* generation_;
+        const FrozenStringSet* stop_words_;
+
+        Snapshot(EpochReclaimer<Generation>::Guard guard, const Generation* generation, const FrozenStringSet* stop_words);
+    };
+
+    template <typename StringCollection>
+    ConcurrentSearchServer(size_t shard_count, const StringCollection& stop_words);
+    ConcurrentSearchServer(size_t shard_count, const std::string& stop_words);
+    explicit ConcurrentSearchServer(size_t shard_count);
+    ~ConcurrentSearchServer();
+
+    ConcurrentSearchServer(const ConcurrentSearchServer&) = delete;
+    ConcurrentSearchServer& operator=(const ConcurrentSearchServer&) = delete;
+
+    // Каждое изменение публикует новое поколение; при исключении поколение не меняется.
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    // Весь пакет публикуется одним поколением, каждый затронутый шард копируется один раз.
+    template <typename DocumentRange>
+    void AddDocuments(const DocumentRange& documents);
+    void RemoveDocument(int document_id);
+    // Отсутствующие id пропускаются; если удалять нечего, поколение не меняется.
+    template <typename DocumentIdRange>
+    void RemoveDocuments(const DocumentIdRange& document_ids);
+
+    Snapshot GetSnapshot() const;
+
+    // Поиск в текущем поколении.
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    size_t GetDocumentCount() const;
+    uint64_t GetGeneration() const;
+    // Число поколений, ожидающих освобождения.
+    size_t GetRetiredGenerationCount() const;
+
+private:
+    FrozenStringSet stop_words_;
+    std::atomic<const Generation*> current_;
+    EpochReclaimer<Generation> reclaimer_;
+    // писатели выполняются по одному; читатели этот мьютекс не берут
+    mutable std::mutex write_mutex_;
+
+    size_t GetShardIndex(int document_id) const;
+    void Publish(std::unique_ptr<Generation> generation);
+};
+
+template <typename StringCollection>
+ConcurrentSearchServer::ConcurrentSearchServer(size_t shard_count, const StringCollection& stop_words)
+{
+    auto generation = std::make_unique<Generation>();
+    generation->number = 0;
+    for (size_t i = 0; i < std::max<size_t>(shard_count, 1); ++i)
+    {
+        // конструктор шарда проверяет стоп-слова
+        generation->shards.push_back(std::make_shared<const SearchServer>(stop_words));
+    }
+    stop_words_ = FrozenStringSet(stop_words);
+    current_.store(generation.release());
+}
+
+template <typename DocumentRange>
+void ConcurrentSearchServer::AddDocuments(const DocumentRange& documents)
+{
+    std::lock_guard guard(write_mutex_);
+    const Generation& current = *current_.load();
+    auto generation = std::make_unique<Generation>(current);
+    ++generation->number;
+
+    std::vector<std::shared_ptr<SearchServer>> copies(generation->shards.size());
+    for (const auto& [document_id, text, status, ratings] : documents)
+    {
+        const size_t shard_index = GetShardIndex(document_id);
+        if (!copies[shard_index])
+        {
+            copies[shard_index] = std::make_shared<SearchServer>(*current.shards[shard_index]);
+            generation->shards[shard_index] = copies[shard_index];
+        }
+        copies[shard_index]->AddDocument(document_id, text, status, ratings);
+    }
+    Publish(std::move(generation));
+}
+
+template <typename DocumentIdRange>
+void ConcurrentSearchServer::RemoveDocuments(const DocumentIdRange& document_ids)
+{
+    std::lock_guard guard(write_mutex_);
+    const Generation& current = *current_.load();
+    auto generation = std::make_unique<Generation>(current);
+
+    std::vector<std::shared_ptr<SearchServer>> copies(generation->shards.size());
+    for (const int document_id : document_ids)
+    {
+        const size_t shard_index = GetShardIndex(document_id);
+        if (!current.shards[shard_index]->HasDocument(document_id))
+        {
+            continue;
+        }
+        if (!copies[shard_index])
+        {
+            copies[shard_index] = std::make_shared<SearchServer>(*current.shards[shard_index]);
+            generation->shards[shard_index] = copies[shard_index];
+        }
+        copies[shard_index]->RemoveDocument(document_id);
+    }
+    if (std::none_of(copies.begin(), copies.end(), [](const auto& copy){ return copy != nullptr; }))
+    {
+        return;
+    }
+    ++generation->number;
+    Publish(std::move(generation));
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ConcurrentSearchServer::Snapshot::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                                         size_t top_k) const
+{
+    return FindTopDocumentsInShards(generation_->shards, *stop_words_, raw_query, document_predicate, top_k);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t top_k) const
+{
+    return GetSnapshot().FindTopDocuments(raw_query, document_predicate, top_k);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "document.h"
+
+#include <type_traits>
+
+// Предикаты документов, которые SearchServer распознаёт при компиляции: фильтр по статусу заранее переводится
+// в исключённые слоты по битовой карте статуса, а отрезки рейтинга и id сравниваются прямо с атрибутами слота,
+// не читая остальных. Их можно передавать и любому другому методу, принимающему предикат (id, status, rating), -
+// там они вызываются как обычные функции. Объединяются через &&, например StatusIs{ DocumentStatus::ACTUAL } && RatingBetween{ 0, 5 }.
+
+struct StatusIs
+{
+    DocumentStatus status;
+
+    bool operator()([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating) const
+    {
+        return document_status == status;
+    }
+};
+
+// рейтинг в отрезке [min_rating, max_rating]
+struct RatingBetween
+{
+    int min_rating;
+    int max_rating;
+
+    bool operator()([[maybe_unused]] int document_id, [[maybe_unused]] DocumentStatus document_status, int rating) const
+    {
+        return min_rating <= rating && rating <= max_rating;
+    }
+};
+
+// id в отрезке [min_id, max_id]
+struct DocumentIdBetween
+{
+    int min_id;
+    int max_id;
+
+    bool operator()(int document_id, [[maybe_unused]] DocumentStatus document_status, [[maybe_unused]] int rating) const
+    {
+        return min_id <= document_id && document_id <= max_id;
+    }
+};
+
+template <typename Left, typename Right>
+struct BothPredicates
+{
+    Left left;
+    Right right;
+
+    bool operator()(int document_id, DocumentStatus document_status, int rating) const
+    {
+        return left(document_id, document_status, rating) && right(document_id, document_status, rating);
+    }
+};
+
+template <typename DocumentPredicate>
+struct IsRecognizedPredicate : std::false_type{};
+
+template <>
+struct IsRecognizedPredicate<StatusIs> : std::true_type{};
+
+template <>
+struct IsRecognizedPredicate<RatingBetween> : std::true_type{};
+
+template <>
+struct IsRecognizedPredicate<DocumentIdBetween> : std::true_type{};
+
+template <typename Left, typename Right>
+struct IsRecognizedPredicate<BothPredicates<Left, Right>>
+    : std::integral_constant<bool, IsRecognizedPredicate<Left>::value && IsRecognizedPredicate<Right>::value>{};
+
+template <typename Left, typename Right,
+          typename = std::enable_if_t<IsRecognizedPredicate<Left>::value && IsRecognizedPredicate<Right>::value>>
+BothPredicates<Left, Right> operator&&(const Left& left, const Right& right)
+{
+    return { left, right };
+}
+
+// Оставшийся предикат, когда распознанный предикат целиком учтён в исключённых слотах.
+struct AnyDocument
+{
+    bool operator()([[maybe_unused]] int document_id, [[maybe_unused]] DocumentStatus document_status, [[maybe_unused]] int rating) const
+    {
+        return true;
+    }
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Отложенное освобождение объектов по эпохам (epoch-based reclamation) для структур, где объект подменяется
+// атомарно, а читатели работают без блокировок. Читатель на время чтения занимает слот и объявляет в нём
+// текущую эпоху. Писатель, подменив объект, откладывает старый с номером эпохи и продвигает эпоху; объект
+// освобождается, когда все занятые слоты объявляют более позднюю эпоху - такие читатели видят уже новый объект.
+// Retire и Collect вызываются одним писателем за раз.
+template <typename Object>
+class EpochReclaimer
+{
+private:
+    static constexpr size_t SLOT_COUNT = 128;
+    static constexpr uint64_t INACTIVE = std::numeric_limits<uint64_t>::max();
+
+    // слоты разнесены по кэш-линиям, чтобы читатели разных потоков не мешали друг другу
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> epoch{ INACTIVE };
+    };
+
+    std::atomic<uint64_t> epoch_{ 0 };
+    mutable std::array<Slot, SLOT_COUNT> slots_;
+    std::vector<std::pair<uint64_t, std::unique_ptr<const Object>>> retired_;
+
+public:
+    // Слот читателя; пока он занят, объекты, видимые читателю, не освобождаются.
+    class Guard
+    {
+    public:
+        explicit Guard(Slot* slot = nullptr)
+            : slot_(slot){}
+        Guard(Guard&& other) noexcept
+            : slot_(std::exchange(other.slot_, nullptr)){}
+        Guard& operator=(Guard&& other) noexcept
+        {
+            std::swap(slot_, other.slot_);
+            return *this;
+        }
+        ~Guard()
+        {
+            if (slot_ != nullptr)
+            {
+                slot_->epoch.store(INACTIVE);
+            }
+        }
+
+    private:
+        Slot* slot_;
+    };
+
+    EpochReclaimer() = default;
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    // Вызывается читателем до чтения указателя на объект. Ждёт только, если заняты все слоты.
+    Guard Pin() const
+    {
+        size_t index = std::hash<std::thread::id>{}(std::this_thread::get_id()) % SLOT_COUNT;
+        for (size_t attempt = 1;; ++attempt, index = (index + 1) % SLOT_COUNT)
+        {
+            uint64_t expected = INACTIVE;
+            // объявленная эпоха может отстать от текущей - это лишь задерживает освобождение
+            if (slots_[index].epoch.compare_exchange_strong(expected, epoch_.load()))
+            {
+                return Guard(&slots_[index]);
+            }
+            if (attempt % SLOT_COUNT == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Вызывается писателем после того, как объект стал недостижим для новых читателей.
+    void Retire(std::unique_ptr<const Object> object)
+    {
+        retired_.emplace_back(epoch_.fetch_add(1), std::move(object));
+        Collect();
+    }
+
+    void Collect()
+    {
+        uint64_t min_epoch = INACTIVE;
+        for (const Slot& slot : slots_)
+        {
+            min_epoch = std::min(min_epoch, slot.epoch.load());
+        }
+        retired_.erase(std::remove_if(retired_.begin(), retired_.end(), [min_epoch](const auto& retired)
+        {
+            return retired.first < min_epoch;
+        }), retired_.end());
+    }
+
+    size_t GetRetiredCount() const
+    {
+        return retired_.size();
+    }
+};
@@ -0,0 +1,130 @@
+#include "frozen_string_set.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+unsigned FirstBit(uint32_t mask)
+{
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+    unsigned bit = 0;
+    for (; (mask & 1) == 0; mask >>= 1)
+    {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+// биты ячеек группы, метка которых равна tag
+uint32_t MatchTags(const uint8_t* group, uint8_t tag)
+{
+#if defined(__SSE2__)
+    const __m128i tags = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(tags, _mm_set1_epi8(static_cast<char>(tag)))));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        mask |= static_cast<uint32_t>(group[i] == tag) << i;
+    }
+    return mask;
+#endif
+}
+}
+
+FrozenStringSet::FrozenStringSet()
+    : cells_(GROUP_SIZE), tags_(GROUP_SIZE, EMPTY_TAG){}
+
+void FrozenStringSet::Build(std::vector<std::string_view> words)
+{
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    size_ = words.size();
+
+    // заполненность не выше половины: поиск отсутствующего слова почти всегда заканчивается в первой группе
+    size_t group_count = 1;
+    while (group_count * GROUP_SIZE < size_ * 2)
+    {
+        group_count *= 2;
+    }
+    group_mask_ = group_count - 1;
+    cells_.assign(group_count * GROUP_SIZE, { 0, 0 });
+    tags_.assign(group_count * GROUP_SIZE, EMPTY_TAG);
+
+    for (const std::string_view word : words)
+    {
+        const size_t hash = std::hash<std::string_view>{}(word);
+        for (size_t group = (hash >> 7) & group_mask_;; group = (group + 1) & group_mask_)
+        {
+            const uint32_t empty_cells = MatchTags(&tags_[group * GROUP_SIZE], EMPTY_TAG);
+            if (empty_cells != 0)
+            {
+                const size_t cell = group * GROUP_SIZE + FirstBit(empty_cells);
+                tags_[cell] = static_cast<uint8_t>(hash & 0x7f);
+                cells_[cell] = { static_cast<uint32_t>(chars_.size()), static_cast<uint32_t>(word.size()) };
+                chars_ += word;
+                break;
+            }
+        }
+    }
+}
+
+std::string_view FrozenStringSet::GetCell(size_t cell) const
+{
+    return std::string_view(chars_).substr(cells_[cell].first, cells_[cell].second);
+}
+
+bool FrozenStringSet::Contains(std::string_view word) const
+{
+    const size_t hash = std::hash<std::string_view>{}(word);
+    const uint8_t tag = static_cast<uint8_t>(hash & 0x7f);
+    for (size_t group = (hash >> 7) & group_mask_;; group = (group + 1) & group_mask_)
+    {
+        const uint8_t* group_tags = &tags_[group * GROUP_SIZE];
+        for (uint32_t matches = MatchTags(group_tags, tag); matches != 0; matches &= matches - 1)
+        {
+            if (GetCell(group * GROUP_SIZE + FirstBit(matches)) == word)
+            {
+                return true;
+            }
+        }
+        // группа с пустой ячейкой завершает цепочку проб
+        if (MatchTags(group_tags, EMPTY_TAG) != 0)
+        {
+            return false;
+        }
+    }
+}
+
+std::vector<std::string_view> FrozenStringSet::GetWords() const
+{
+    std::vector<std::string_view> words;
+    words.reserve(size_);
+    for (size_t cell = 0; cell < tags_.size(); ++cell)
+    {
+        if (tags_[cell] != EMPTY_TAG)
+        {
+            words.push_back(GetCell(cell));
+        }
+    }
+    std::sort(words.begin(), words.end());
+    return words;
+}
+
+size_t FrozenStringSet::size() const
+{
+    return size_;
+}
+
+bool FrozenStringSet::empty() const
+{
+    return size_ == 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Неизменяемое множество строк для поиска по string_view без выделения памяти.
+// Открытая адресация группами по GROUP_SIZE ячеек: для каждой ячейки хранится байт-метка (7 бит хеша),
+// и вся группа сравнивается с меткой одной SIMD-инструкцией. Строки лежат подряд в одном буфере.
+class FrozenStringSet
+{
+public:
+    FrozenStringSet();
+
+    template <typename StringCollection>
+    explicit FrozenStringSet(const StringCollection& strings);
+
+    bool Contains(std::string_view word) const;
+    // все строки множества по возрастанию
+    std::vector<std::string_view> GetWords() const;
+    size_t size() const;
+    bool empty() const;
+
+private:
+    static constexpr size_t GROUP_SIZE = 16;
+    static constexpr uint8_t EMPTY_TAG = 0x80;
+
+    std::string chars_;
+    // смещение и длина строки в chars_ для каждой ячейки
+    std::vector<std::pair<uint32_t, uint32_t>> cells_;
+    std::vector<uint8_t> tags_;
+    size_t group_mask_ = 0;
+    size_t size_ = 0;
+
+    void Build(std::vector<std::string_view> words);
+    std::string_view GetCell(size_t cell) const;
+};
+
+template <typename StringCollection>
+FrozenStringSet::FrozenStringSet(const StringCollection& strings)
+{
+    std::vector<std::string_view> words;
+    for (const std::string_view word : strings)
+    {
+        words.push_back(word);
+    }
+    Build(std::move(words));
+}
@@ -0,0 +1,96 @@
+#include "impact_postings.h"
+
+#include <algorithm>
+
+uint32_t ImpactPostings::QuantizeTermFreq(double term_freq)
+{
+    // частота терма лежит в (0, 1]
+    return std::min(LEVEL_COUNT - 1, static_cast<uint32_t>(term_freq * LEVEL_COUNT));
+}
+
+std::vector<ImpactPostings::Segment>::iterator ImpactPostings::FindSegment(uint32_t level)
+{
+    return std::lower_bound(segments_.begin(), segments_.end(), level, [](const Segment& segment, uint32_t level)
+    {
+        return segment.level > level;
+    });
+}
+
+void ImpactPostings::Add(int slot, uint32_t count, double term_freq)
+{
+    const uint32_t level = QuantizeTermFreq(term_freq);
+    auto segment = FindSegment(level);
+    if (segment == segments_.end() || segment->level != level)
+    {
+        segment = segments_.insert(segment, { level, term_freq, {}, {} });
+    }
+    segment->max_term_freq = std::max(segment->max_term_freq, term_freq);
+
+    // новые документы обычно получают слоты больше существующих
+    if (segment->slots.empty() || segment->slots.back() < slot)
+    {
+        segment->slots.push_back(slot);
+        segment->counts.push_back(count);
+    }
+    else
+    {
+        const auto position = std::lower_bound(segment->slots.begin(), segment->slots.end(), slot);
+        segment->counts.insert(segment->counts.begin() + (position - segment->slots.begin()), count);
+        segment->slots.insert(position, slot);
+    }
+    ++size_;
+}
+
+bool ImpactPostings::Remove(int slot, double term_freq)
+{
+    const uint32_t level = QuantizeTermFreq(term_freq);
+    const auto segment = FindSegment(level);
+    if (segment == segments_.end() || segment->level != level)
+    {
+        return false;
+    }
+    const auto position = std::lower_bound(segment->slots.begin(), segment->slots.end(), slot);
+    if (position == segment->slots.end() || *position != slot)
+    {
+        return false;
+    }
+    segment->counts.erase(segment->counts.begin() + (position - segment->slots.begin()));
+    segment->slots.erase(position);
+    if (segment->slots.empty())
+    {
+        segments_.erase(segment);
+    }
+    --size_;
+    return true;
+}
+
+void ImpactPostings::Clear()
+{
+    std::vector<Segment>().swap(segments_);
+    size_ = 0;
+}
+
+const std::vector<ImpactPostings::Segment>& ImpactPostings::GetSegments() const
+{
+    return segments_;
+}
+
+size_t ImpactPostings::size() const
+{
+    return size_;
+}
+
+bool ImpactPostings::empty() const
+{
+    return size_ == 0;
+}
+
+size_t ImpactPostings::GetMemoryUsage() const
+{
+    size_t memory_usage = sizeof(ImpactPostings) + segments_.capacity() * sizeof(Segment);
+    for (const Segment& segment : segments_)
+    {
+        memory_usage += segment.slots.capacity() * sizeof(int) + segment.counts.capacity() * sizeof(uint32_t);
+    }
+    return memory_usage;
+}
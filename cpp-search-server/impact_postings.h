@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Вхождения терма, сгруппированные по квантованной частоте терма в документе. IDF у всех вхождений терма общий,
+// поэтому порядок по частоте совпадает с порядком по вкладу TF-IDF. Сегменты упорядочены по убыванию уровня,
+// вхождения внутри сегмента - по слоту.
+class ImpactPostings
+{
+public:
+    static constexpr uint32_t LEVEL_COUNT = 256;
+
+    struct Segment
+    {
+        uint32_t level;
+        // верхняя граница частоты терма в сегменте: при удалении документов не уменьшается
+        double max_term_freq;
+        std::vector<int> slots;
+        std::vector<uint32_t> counts;
+    };
+
+    // term_freq должен совпадать при добавлении и удалении одного вхождения
+    void Add(int slot, uint32_t count, double term_freq);
+    bool Remove(int slot, double term_freq);
+    void Clear();
+
+    const std::vector<Segment>& GetSegments() const;
+    size_t size() const;
+    bool empty() const;
+    size_t GetMemoryUsage() const;
+
+    static uint32_t QuantizeTermFreq(double term_freq);
+
+private:
+    std::vector<Segment> segments_;
+    size_t size_ = 0;
+
+    std::vector<Segment>::iterator FindSegment(uint32_t level);
+};
@@ -0,0 +1,270 @@
+#include "index_snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using std::string_literals::operator""s;
+
+namespace
+{
+// число в формате блоков PostingList; бросает std::invalid_argument, если оно не заканчивается до end
+uint32_t ReadVarint(const uint8_t*& data, const uint8_t* end)
+{
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (data == end)
+        {
+            throw std::invalid_argument("Snapshot posting block is out of file bounds"s);
+        }
+        const uint8_t byte = *data++;
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+    throw std::invalid_argument("Snapshot posting block has a malformed number"s);
+}
+}
+
+MappedSearchServer::MappedSearchServer(const std::string& path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot open snapshot "s + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(snapshot::Header))
+    {
+        close(fd);
+        throw std::runtime_error("Snapshot "s + path + " is truncated"s);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        throw std::runtime_error("Cannot map snapshot "s + path);
+    }
+    data_ = static_cast<const uint8_t*>(data);
+
+    try
+    {
+        header_ = reinterpret_cast<const snapshot::Header*>(data_);
+        if (std::memcmp(header_->magic, snapshot::MAGIC, sizeof(snapshot::MAGIC)) != 0
+            || header_->version != snapshot::VERSION || header_->byte_order_mark != snapshot::BYTE_ORDER_MARK)
+        {
+            throw std::runtime_error("File "s + path + " is not a snapshot of version "s + std::to_string(snapshot::VERSION));
+        }
+
+        terms_ = GetSection<snapshot::Term>(header_->terms);
+        blocks_ = GetSection<PostingList::BlockInfo>(header_->blocks);
+        posting_bytes_ = GetSection<uint8_t>(header_->posting_bytes);
+        chars_ = GetSection<char>(header_->chars);
+        slot_document_ids_ = GetSection<int32_t>(header_->slot_document_ids);
+        slot_statuses_ = GetSection<int32_t>(header_->slot_statuses);
+        slot_ratings_ = GetSection<int32_t>(header_->slot_ratings);
+        slot_inv_word_counts_ = GetSection<double>(header_->slot_inv_word_counts);
+        documents_ = GetSection<snapshot::DocumentSlot>(header_->documents);
+        const uint64_t slot_count = header_->slot_document_ids.count;
+        if (header_->slot_statuses.count != slot_count || header_->slot_ratings.count != slot_count
+            || header_->slot_inv_word_counts.count != slot_count || slot_count > static_cast<uint64_t>(std::numeric_limits<int>::max()))
+        {
+            throw std::invalid_argument("Snapshot "s + path + " has inconsistent slot sections"s);
+        }
+        for (uint64_t i = 0; i < header_->terms.count; ++i)
+        {
+            ValidateTerm(terms_[i]);
+        }
+        for (uint64_t i = 0; i < header_->documents.count; ++i)
+        {
+            if (documents_[i].slot < 0 || static_cast<uint64_t>(documents_[i].slot) >= slot_count)
+            {
+                throw std::invalid_argument("Snapshot "s + path + " has a document slot out of range"s);
+            }
+        }
+
+        const snapshot::StringRef* stop_words = GetSection<snapshot::StringRef>(header_->stop_words);
+        std::vector<std::string_view> words;
+        for (uint64_t i = 0; i < header_->stop_words.count; ++i)
+        {
+            ValidateString(stop_words[i]);
+            words.push_back(GetString(stop_words[i]));
+        }
+        stop_words_ = FrozenStringSet(words);
+    }
+    catch (...)
+    {
+        munmap(const_cast<uint8_t*>(data_), size_);
+        throw;
+    }
+}
+
+MappedSearchServer::~MappedSearchServer()
+{
+    munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+template <typename Item>
+const Item* MappedSearchServer::GetSection(const snapshot::Section& section) const
+{
+    if (section.offset % alignof(Item) != 0 || section.offset > size_ || section.count > (size_ - section.offset) / sizeof(Item))
+    {
+        throw std::invalid_argument("Snapshot section is out of file bounds"s);
+    }
+    return reinterpret_cast<const Item*>(data_ + section.offset);
+}
+
+std::string_view MappedSearchServer::GetString(const snapshot::StringRef& string) const
+{
+    return { chars_ + string.offset, string.size };
+}
+
+void MappedSearchServer::ValidateString(const snapshot::StringRef& string) const
+{
+    if (string.offset > header_->chars.count || string.size > header_->chars.count - string.offset)
+    {
+        throw std::invalid_argument("Snapshot string is out of file bounds"s);
+    }
+}
+
+void MappedSearchServer::ValidateTerm(const snapshot::Term& term) const
+{
+    ValidateString(term.word);
+    if (term.block_count > header_->blocks.count || term.first_block > header_->blocks.count - term.block_count
+        || term.bytes_offset > header_->posting_bytes.count)
+    {
+        throw std::invalid_argument("Snapshot term is out of file bounds"s);
+    }
+
+    // блоки раскодируются так же, как в DecodeBlock, но с проверкой границ байтов и слотов
+    const uint64_t slot_count = header_->slot_document_ids.count;
+    const uint8_t* bytes_end = posting_bytes_ + header_->posting_bytes.count;
+    uint64_t posting_count = 0;
+    int64_t previous_slot = -1;
+    for (uint64_t block = term.first_block; block < term.first_block + term.block_count; ++block)
+    {
+        const PostingList::BlockInfo& info = blocks_[block];
+        if (info.size == 0 || info.size > PostingList::MAX_BLOCK_SIZE || info.offset > header_->posting_bytes.count - term.bytes_offset)
+        {
+            throw std::invalid_argument("Snapshot posting block is out of file bounds"s);
+        }
+        const uint8_t* data = posting_bytes_ + term.bytes_offset + info.offset;
+        int64_t slot = info.first_slot;
+        for (uint32_t i = 0; i < info.size; ++i)
+        {
+            if (i > 0)
+            {
+                slot += ReadVarint(data, bytes_end);
+            }
+            // слоты списка строго возрастают и адресуют секции слотов
+            if (slot <= previous_slot || static_cast<uint64_t>(slot) >= slot_count)
+            {
+                throw std::invalid_argument("Snapshot posting slot is out of range"s);
+            }
+            previous_slot = slot;
+        }
+        if (slot != info.last_slot)
+        {
+            throw std::invalid_argument("Snapshot posting block has a wrong last slot"s);
+        }
+        for (uint32_t i = 0; i < info.size; ++i)
+        {
+            ReadVarint(data, bytes_end);
+        }
+        posting_count += info.size;
+    }
+    if (posting_count == 0 || posting_count != term.posting_count)
+    {
+        throw std::invalid_argument("Snapshot term has a wrong posting count"s);
+    }
+}
+
+const snapshot::Term* MappedSearchServer::FindTerm(std::string_view word) const
+{
+    const snapshot::Term* end = terms_ + header_->terms.count;
+    const snapshot::Term* it = std::lower_bound(terms_, end, word, [this](const snapshot::Term& term, std::string_view word)
+    {
+        return GetString(term.word) < word;
+    });
+    return it != end && GetString(it->word) == word ? it : nullptr;
+}
+
+int MappedSearchServer::FindSlot(int document_id) const
+{
+    const snapshot::DocumentSlot* end = documents_ + header_->documents.count;
+    const snapshot::DocumentSlot* it = std::lower_bound(documents_, end, document_id, [](const snapshot::DocumentSlot& document, int document_id)
+    {
+        return document.document_id < document_id;
+    });
+    return it != end && it->document_id == document_id ? it->slot : -1;
+}
+
+bool MappedSearchServer::Contains(const snapshot::Term& term, int slot) const
+{
+    const PostingList::BlockInfo* first = blocks_ + term.first_block;
+    const PostingList::BlockInfo* last = first + term.block_count;
+    const PostingList::BlockInfo* block = std::lower_bound(first, last, slot, [](const PostingList::BlockInfo& info, int slot)
+    {
+        return info.last_slot < slot;
+    });
+    if (block == last || block->first_slot > slot)
+    {
+        return false;
+    }
+
+    std::array<int, PostingList::MAX_BLOCK_SIZE> slot_buffer;
+    std::array<uint32_t, PostingList::MAX_BLOCK_SIZE> count_buffer;
+    const PostingList::Block decoded = PostingList::DecodeBlock(*block, posting_bytes_ + term.bytes_offset, slot_buffer.data(), count_buffer.data());
+    return std::binary_search(decoded.slots, decoded.slots + decoded.size, slot);
+}
+
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t top_k) const
+{
+    return FindTopDocuments(raw_query, StatusIs{ status }, top_k);
+}
+
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query) const
+{
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> MappedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const
+{
+    const SearchQuery query = ParseSearchQuery(raw_query, stop_words_, true);
+    const int slot = FindSlot(document_id);
+    if (slot < 0)
+    {
+        throw std::out_of_range("Document out of range");
+    }
+
+    const auto contains_document = [this, slot](std::string_view word)
+    {
+        const snapshot::Term* term = FindTerm(word);
+        return term != nullptr && Contains(*term, slot);
+    };
+
+    const DocumentStatus status = static_cast<DocumentStatus>(slot_statuses_[slot]);
+    if (std::any_of(query.minus_words.begin(), query.minus_words.end(), contains_document))
+    {
+        return { std::vector<std::string_view>{}, status };
+    }
+
+    std::vector<std::string_view> matched_words;
+    std::copy_if(query.plus_words.begin(), query.plus_words.end(), std::back_inserter(matched_words), contains_document);
+    return { matched_words, status };
+}
+
+size_t MappedSearchServer::GetDocumentCount() const
+{
+    return header_->document_count;
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include "document.h"
+#include "frozen_string_set.h"
+#include "posting_list.h"
+#include "search_query.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Формат снимка индекса (SearchServer::SaveSnapshot). Секции выровнены по 8 байт,
+// числа записаны в порядке байт машины, создавшей снимок.
+namespace snapshot
+{
+const char MAGIC[8] = { 'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P' };
+const uint32_t VERSION = 1;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// смещение секции от начала файла и число элементов в ней
+struct Section
+{
+    uint64_t offset;
+    uint64_t count;
+};
+
+// строка в секции chars
+struct StringRef
+{
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct Term
+{
+    StringRef word;
+    uint64_t first_block;
+    uint64_t block_count;
+    // начало байтов терма в секции posting_bytes; смещения его блоков отсчитываются отсюда
+    uint64_t bytes_offset;
+    uint64_t posting_count;
+};
+
+struct DocumentSlot
+{
+    int32_t document_id;
+    int32_t slot;
+};
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint64_t document_count;
+    Section stop_words;             // StringRef по возрастанию строк
+    Section terms;                  // Term по возрастанию слов
+    Section blocks;                 // PostingList::BlockInfo, не больше BLOCK_SIZE вхождений в блоке
+    Section posting_bytes;          // uint8_t
+    Section chars;                  // char
+    Section slot_document_ids;      // int32_t, -1 у свободного слота
+    Section slot_statuses;          // int32_t
+    Section slot_ratings;           // int32_t
+    Section slot_inv_word_counts;   // double
+    Section documents;              // DocumentSlot по возрастанию id
+};
+}
+
+// Поисковый сервер только для чтения поверх снимка, отображённого в память через mmap.
+// Списки вхождений и атрибуты документов читаются прямо со страниц файла, копируются только стоп-слова.
+// При открытии снимок один раз проходится целиком: строки, блоки вхождений и слоты сверяются с границами
+// секций, поэтому поиск по открытому снимку не читает за пределами файла. Результаты совпадают
+// с последовательными методами SearchServer.
+class MappedSearchServer
+{
+public:
+    // бросает std::runtime_error, если файл не открывается или не является снимком этой версии,
+    // и std::invalid_argument, если снимок повреждён
+    explicit MappedSearchServer(const std::string& path);
+    ~MappedSearchServer();
+
+    MappedSearchServer(const MappedSearchServer&) = delete;
+    MappedSearchServer& operator=(const MappedSearchServer&) = delete;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    size_t GetDocumentCount() const;
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+    const snapshot::Header* header_ = nullptr;
+    const snapshot::Term* terms_ = nullptr;
+    const PostingList::BlockInfo* blocks_ = nullptr;
+    const uint8_t* posting_bytes_ = nullptr;
+    const char* chars_ = nullptr;
+    const int32_t* slot_document_ids_ = nullptr;
+    const int32_t* slot_statuses_ = nullptr;
+    const int32_t* slot_ratings_ = nullptr;
+    const double* slot_inv_word_counts_ = nullptr;
+    const snapshot::DocumentSlot* documents_ = nullptr;
+    FrozenStringSet stop_words_;
+
+    template <typename Item>
+    const Item* GetSection(const snapshot::Section& section) const;
+    std::string_view GetString(const snapshot::StringRef& string) const;
+    void ValidateString(const snapshot::StringRef& string) const;
+    void ValidateTerm(const snapshot::Term& term) const;
+    const snapshot::Term* FindTerm(std::string_view word) const;
+    int FindSlot(int document_id) const;
+    bool Contains(const snapshot::Term& term, int slot) const;
+
+    template <typename Function>
+    void ForEachBlock(const snapshot::Term& term, Function function) const;
+};
+
+template <typename Function>
+void MappedSearchServer::ForEachBlock(const snapshot::Term& term, Function function) const
+{
+    std::array<int, PostingList::MAX_BLOCK_SIZE> slot_buffer;
+    std::array<uint32_t, PostingList::MAX_BLOCK_SIZE> count_buffer;
+    for (uint64_t block = term.first_block; block < term.first_block + term.block_count; ++block)
+    {
+        function(PostingList::DecodeBlock(blocks_[block], posting_bytes_ + term.bytes_offset, slot_buffer.data(), count_buffer.data()));
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t top_k) const
+{
+    const SearchQuery query = ParseSearchQuery(raw_query, stop_words_, true);
+    const size_t slot_count = header_->slot_document_ids.count;
+    std::vector<double> document_to_relevance(slot_count);
+    std::vector<char> is_matched(slot_count);
+
+    for (const std::string_view word : query.plus_words)
+    {
+        const snapshot::Term* term = FindTerm(word);
+        if (term == nullptr)
+        {
+            continue;
+        }
+        const double inverse_document_freq = std::log(GetDocumentCount() * 1.0 / term->posting_count);
+        ForEachBlock(*term, [&](const PostingList::Block& block)
+        {
+            for (size_t i = 0; i < block.size; ++i)
+            {
+                const int slot = block.slots[i];
+                if (document_predicate(slot_document_ids_[slot], static_cast<DocumentStatus>(slot_statuses_[slot]), slot_ratings_[slot]))
+                {
+                    // тот же порядок операций, что и в SearchServer, чтобы релевантность совпадала бит в бит
+                    document_to_relevance[slot] += block.counts[i] * slot_inv_word_counts_[slot] * inverse_document_freq;
+                    is_matched[slot] = 1;
+                }
+            }
+        });
+    }
+
+    for (const std::string_view word : query.minus_words)
+    {
+        const snapshot::Term* term = FindTerm(word);
+        if (term == nullptr)
+        {
+            continue;
+        }
+        ForEachBlock(*term, [&is_matched](const PostingList::Block& block)
+        {
+            for (size_t i = 0; i < block.size; ++i)
+            {
+                is_matched[block.slots[i]] = 0;
+            }
+        });
+    }
+
+    std::vector<Document> matched_documents;
+    for (size_t slot = 0; slot < slot_count; ++slot)
+    {
+        if (is_matched[slot])
+        {
+            matched_documents.push_back({slot_document_ids_[slot], document_to_relevance[slot], slot_ratings_[slot]});
+        }
+    }
+    SelectTopDocuments(matched_documents, top_k);
+    return matched_documents;
+}
@@ -0,0 +1,139 @@
+#include "inverted_index.h"
+
+#include <algorithm>
+
+//--------------------TermDictionary------------------//
+std::string_view TermDictionary::Store(std::string_view word)
+{
+    char* data;
+    if (word.size() > ARENA_CHUNK_SIZE / 2)
+    {
+        // длинное слово получает собственный кусок, текущий кусок продолжает заполняться
+        long_terms_.push_back(std::make_unique<char[]>(word.size()));
+        data = long_terms_.back().get();
+    }
+    else
+    {
+        if (arena_chunks_.empty() || word.size() > ARENA_CHUNK_SIZE - chunk_used_)
+        {
+            arena_chunks_.push_back(std::make_unique<char[]>(ARENA_CHUNK_SIZE));
+            chunk_used_ = 0;
+        }
+        data = arena_chunks_.back().get() + chunk_used_;
+        chunk_used_ += word.size();
+    }
+    std::copy(word.begin(), word.end(), data);
+    return { data, word.size() };
+}
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+{
+    terms_.reserve(other.terms_.size());
+    term_ids_.reserve(other.term_ids_.size());
+    for (const std::string_view word : other.terms_)
+    {
+        Intern(word);
+    }
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other)
+{
+    if (this != &other)
+    {
+        *this = TermDictionary(other);
+    }
+    return *this;
+}
+
+int TermDictionary::Intern(std::string_view word)
+{
+    const auto it = term_ids_.find(word);
+    if (it != term_ids_.end())
+    {
+        return it->second;
+    }
+
+    const int term_id = static_cast<int>(terms_.size());
+    const std::string_view stored = Store(word);
+    terms_.push_back(stored);
+    term_ids_.emplace(stored, term_id);
+    return term_id;
+}
+
+int TermDictionary::Find(std::string_view word) const
+{
+    const auto it = term_ids_.find(word);
+    return it == term_ids_.end() ? NO_TERM : it->second;
+}
+
+std::string_view TermDictionary::GetTerm(int term_id) const
+{
+    return terms_[term_id];
+}
+
+size_t TermDictionary::size() const
+{
+    return terms_.size();
+}
+
+//--------------------WordFrequencies::Iterator------------------//
+WordFrequencies::Iterator::Iterator(const TermDictionary* terms, const TermOccurrence* occurrence, double inv_word_count)
+    : terms_(terms), occurrence_(occurrence), inv_word_count_(inv_word_count){}
+
+WordFrequencies::Iterator::reference WordFrequencies::Iterator::operator*() const
+{
+    value_ = { terms_->GetTerm(occurrence_->term_id), occurrence_->count * inv_word_count_ };
+    return value_;
+}
+
+WordFrequencies::Iterator::pointer WordFrequencies::Iterator::operator->() const
+{
+    return &**this;
+}
+
+WordFrequencies::Iterator& WordFrequencies::Iterator::operator++()
+{
+    ++occurrence_;
+    return *this;
+}
+
+WordFrequencies::Iterator WordFrequencies::Iterator::operator++(int)
+{
+    Iterator previous = *this;
+    ++occurrence_;
+    return previous;
+}
+
+bool WordFrequencies::Iterator::operator==(const Iterator& other) const
+{
+    return occurrence_ == other.occurrence_;
+}
+
+bool WordFrequencies::Iterator::operator!=(const Iterator& other) const
+{
+    return occurrence_ != other.occurrence_;
+}
+
+//--------------------WordFrequencies------------------//
+WordFrequencies::WordFrequencies(const TermDictionary& terms, const std::vector<TermOccurrence>& occurrences, double inv_word_count)
+    : terms_(&terms), first_(occurrences.data()), last_(occurrences.data() + occurrences.size()), inv_word_count_(inv_word_count){}
+
+WordFrequencies::Iterator WordFrequencies::begin() const
+{
+    return { terms_, first_, inv_word_count_ };
+}
+
+WordFrequencies::Iterator WordFrequencies::end() const
+{
+    return { terms_, last_, inv_word_count_ };
+}
+
+size_t WordFrequencies::size() const
+{
+    return last_ - first_;
+}
+
+bool WordFrequencies::empty() const
+{
+    return first_ == last_;
+}
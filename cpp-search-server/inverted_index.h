@@ -0,0 +1,96 @@
+#pragma once
+
+#include "posting_list.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Словарь термов: каждое слово хранится один раз и получает плотный номер.
+// Символы термов лежат в общей арене из крупных кусков, поэтому на новый терм не тратится отдельная аллокация строки.
+class TermDictionary
+{
+private:
+    static constexpr size_t ARENA_CHUNK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> arena_chunks_;
+    size_t chunk_used_ = 0;
+    std::vector<std::unique_ptr<char[]>> long_terms_;
+    std::vector<std::string_view> terms_;
+    std::unordered_map<std::string_view, int> term_ids_;
+
+    std::string_view Store(std::string_view word);
+
+public:
+    static constexpr int NO_TERM = -1;
+
+    TermDictionary() = default;
+    // string_view ключей указывают в арену, поэтому копия заново раскладывает термы в свою арену с теми же номерами
+    TermDictionary(const TermDictionary& other);
+    TermDictionary& operator=(const TermDictionary& other);
+    TermDictionary(TermDictionary&&) = default;
+    TermDictionary& operator=(TermDictionary&&) = default;
+
+    int Intern(std::string_view word);
+    int Find(std::string_view word) const;
+    std::string_view GetTerm(int term_id) const;
+    size_t size() const;
+};
+
+// Вхождение терма в документ: прямой индекс документа хранит номера термов, а не строки.
+struct TermOccurrence
+{
+    int term_id;
+    uint32_t count;
+};
+
+// Частоты слов документа в порядке возрастания слов. Не владеет данными: слова берутся из словаря,
+// частота считается как count / число слов документа. Действительно до изменения документа.
+class WordFrequencies
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<std::string_view, double>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        Iterator(const TermDictionary* terms, const TermOccurrence* occurrence, double inv_word_count);
+
+        reference operator*() const;
+        pointer operator->() const;
+        Iterator& operator++();
+        Iterator operator++(int);
+        bool operator==(const Iterator& other) const;
+        bool operator!=(const Iterator& other) const;
+
+    private:
+        const TermDictionary* terms_;
+        const TermOccurrence* occurrence_;
+        double inv_word_count_;
+        mutable value_type value_;
+    };
+
+    WordFrequencies() = default;
+    WordFrequencies(const TermDictionary& terms, const std::vector<TermOccurrence>& occurrences, double inv_word_count);
+
+    Iterator begin() const;
+    Iterator end() const;
+    size_t size() const;
+    bool empty() const;
+
+private:
+    const TermDictionary* terms_ = nullptr;
+    const TermOccurrence* first_ = nullptr;
+    const TermOccurrence* last_ = nullptr;
+    double inv_word_count_ = 0.0;
+};
@@ -5,9 +5,22 @@
 //#include "log_duration.h"
 #include <random>
 #include "search_server.h"
+#include "concurrent_map.h"
+#include "index_snapshot.h"
+#include "sharded_search_server.h"
+#include "segmented_search_server.h"
+#include "test_example_functions.h"
+#include <chrono>
+#include <cstdio>
 #include <execution>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace std;
@@ -62,13 +75,537 @@ void Test(string_view mark, const SearchServer& search_server, const vector<stri
     cout << total_relevance << endl;
 }
 #define TEST(policy) Test(#policy, search_server, queries, execution::policy)
+void TestParallelScaling(SearchServer& search_server, const vector<string>& queries) {
+    const size_t max_thread_count = max(1u, thread::hardware_concurrency());
+    for (size_t thread_count = 1; thread_count <= max_thread_count; ++thread_count) {
+        search_server.SetThreadCount(thread_count);
+        Test("par, threads = "s + to_string(thread_count), search_server, queries, execution::par);
+    }
+}
+void TestPrunedSearch(string_view mark, const SearchServer& search_server, const vector<string>& queries) {
+    PruningStats stats;
+    double total_relevance = 0;
+    {
+        LOG_DURATION(mark);
+        for (const string_view query : queries) {
+            for (const auto& document : search_server.FindTopDocumentsPruned(query, DocumentStatus::ACTUAL, MAX_RESULT_DOCUMENT_COUNT, &stats)) {
+                total_relevance += document.relevance;
+            }
+        }
+    }
+    cout << total_relevance << ", postings scored = "s << stats.postings_scored << ", skipped = "s << stats.postings_skipped << endl;
+}
+// Запросы, где у слова есть шанс minus_prob стать минус-словом: фильтр по статусу и по произвольному предикату.
+void TestMinusWordQueries(const SearchServer& search_server, const vector<string>& dictionary) {
+    mt19937 generator;
+    for (const double minus_prob : {0.0, 0.3, 0.7}) {
+        vector<string> queries;
+        for (int i = 0; i < 100; ++i) {
+            queries.push_back(GenerateQuery(generator, dictionary, 70, minus_prob));
+        }
+        const string mark = "minus_prob = "s + to_string(minus_prob).substr(0, 3);
+        Test(mark + ", seq, status"s, search_server, queries, execution::seq);
+        Test(mark + ", par, status"s, search_server, queries, execution::par);
+        LOG_DURATION(mark + ", seq, predicate"s);
+        double total_relevance = 0;
+        for (const string_view query : queries) {
+            for (const auto& document : search_server.FindTopDocuments(query, []([[maybe_unused]] int document_id, [[maybe_unused]] DocumentStatus status, int rating) { return rating > 0; })) {
+                total_relevance += document.relevance;
+            }
+        }
+        cout << total_relevance << endl;
+    }
+}
+// Предикаты, распознанные при компиляции (document_predicates.h), против тех же условий в лямбдах.
+template <typename DocumentPredicate>
+void TestPredicate(string_view mark, const SearchServer& search_server, const vector<string>& queries, DocumentPredicate document_predicate) {
+    LOG_DURATION(mark);
+    double total_relevance = 0;
+    for (const string_view query : queries) {
+        for (const auto& document : search_server.FindTopDocuments(query, document_predicate)) {
+            total_relevance += document.relevance;
+        }
+    }
+    cout << total_relevance << endl;
+}
+void TestIndexedPredicates(const SearchServer& search_server, const vector<string>& queries) {
+    TestPredicate("predicate, ids lambda"s, search_server, queries, [](int document_id, [[maybe_unused]] DocumentStatus status, [[maybe_unused]] int rating) { return document_id < 1000; });
+    TestPredicate("predicate, DocumentIdBetween"s, search_server, queries, DocumentIdBetween{0, 999});
+    TestPredicate("predicate, status and rating lambda"s, search_server, queries, []([[maybe_unused]] int document_id, DocumentStatus status, int rating) {
+        return status == DocumentStatus::ACTUAL && rating >= 2;
+    });
+    TestPredicate("predicate, StatusIs && RatingBetween"s, search_server, queries,
+                  StatusIs{DocumentStatus::ACTUAL} && RatingBetween{2, numeric_limits<int>::max()});
+}
+// Поиск в контексте вызывающего (без выделений памяти) против обычного FindTopDocuments.
+void TestQueryContext(const SearchServer& search_server, const vector<string>& queries) {
+    Test("query context, FindTopDocuments"s, search_server, queries, execution::seq);
+    QueryContext context;
+    LOG_DURATION("query context, reused context"s);
+    double total_relevance = 0;
+    for (const string_view query : queries) {
+        for (const auto& document : search_server.FindTopDocuments(context, query)) {
+            total_relevance += document.relevance;
+        }
+    }
+    cout << total_relevance << endl;
+}
+// Цена модели ранжирования: BM25 против TF-IDF по умолчанию на тех же запросах.
+template <typename RankingModel>
+void TestRankingModel(string_view mark, const SearchServer& search_server, const vector<string>& queries) {
+    LOG_DURATION(mark);
+    double total_relevance = 0;
+    for (const string_view query : queries) {
+        for (const auto& document : search_server.FindTopDocuments<RankingModel>(query)) {
+            total_relevance += document.relevance;
+        }
+    }
+    cout << total_relevance << endl;
+}
+// Задержка и полнота поиска по вкладу при разных бюджетах относительно полного FindTopDocuments.
+void TestImpactSearch(SearchServer& search_server, const vector<string>& queries) {
+    search_server.SetImpactOrderedPostings(true);
+    vector<vector<Document>> expected(queries.size());
+    {
+        LOG_DURATION("impact, exhaustive FindTopDocuments"s);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            expected[i] = search_server.FindTopDocuments(queries[i]);
+        }
+    }
+    for (const size_t budget : {NO_POSTINGS_BUDGET, size_t{20'000}, size_t{5'000}, size_t{1'000}, size_t{200}}) {
+        const string mark = budget == NO_POSTINGS_BUDGET ? "impact, no budget"s : "impact, budget "s + to_string(budget);
+        ImpactSearchStats stats;
+        size_t exact_count = 0;
+        vector<vector<Document>> found(queries.size());
+        {
+            LOG_DURATION(mark);
+            for (size_t i = 0; i < queries.size(); ++i) {
+                found[i] = search_server.FindTopDocumentsByImpact(queries[i], DocumentStatus::ACTUAL, MAX_RESULT_DOCUMENT_COUNT, budget, &stats);
+                exact_count += stats.is_exact ? 1 : 0;
+            }
+        }
+        size_t relevant = 0;
+        size_t retrieved_relevant = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            set<int> expected_ids;
+            for (const Document& document : expected[i]) {
+                expected_ids.insert(document.id);
+            }
+            relevant += expected_ids.size();
+            for (const Document& document : found[i]) {
+                retrieved_relevant += expected_ids.count(document.id);
+            }
+        }
+        cout << mark << ": recall = "s << (relevant == 0 ? 1.0 : retrieved_relevant * 1.0 / relevant)
+             << ", exact queries = "s << exact_count << "/"s << queries.size()
+             << ", postings scored = "s << stats.postings_scored << " of "s << stats.postings_total << endl;
+    }
+    search_server.SetImpactOrderedPostings(false);
+}
+void TestShardedSearch(const string& stop_words, const vector<string>& documents, const vector<string>& queries) {
+    const size_t max_shard_count = 2 * max(1u, thread::hardware_concurrency());
+    for (size_t shard_count = 1; shard_count <= max_shard_count; shard_count *= 2) {
+        ShardedSearchServer search_server(shard_count, stop_words);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        LOG_DURATION("sharded, shards = "s + to_string(shard_count));
+        double total_relevance = 0;
+        for (const string_view query : queries) {
+            for (const auto& document : search_server.FindTopDocuments(query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        cout << total_relevance << endl;
+    }
+}
+void TestSegmentedIngest(const string& stop_words, const vector<string>& documents, const vector<string>& queries) {
+    {
+        SearchServer search_server(stop_words);
+        {
+            LOG_DURATION("ingest, single index"s);
+            for (size_t i = 0; i < documents.size(); ++i) {
+                search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            }
+        }
+        Test("queries, single index"s, search_server, queries, execution::seq);
+    }
+    {
+        SegmentedSearchServer search_server(stop_words);
+        {
+            LOG_DURATION("ingest, segmented"s);
+            for (size_t i = 0; i < documents.size(); ++i) {
+                search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            }
+        }
+        {
+            LOG_DURATION("ingest, segmented, background merges"s);
+            search_server.WaitForMerges();
+        }
+        for (size_t i = 0; i < documents.size(); i += 10) {
+            search_server.RemoveDocument(i);
+        }
+        cout << "segments: "s << search_server.GetSegmentCount() << ", tombstones: "s << search_server.GetTombstoneCount() << endl;
+        LOG_DURATION("queries, segmented"s);
+        double total_relevance = 0;
+        for (const string_view query : queries) {
+            for (const auto& document : search_server.FindTopDocuments(query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        cout << total_relevance << endl;
+    }
+}
+void TestPostingCodecs(SearchServer& search_server, const vector<string>& queries) {
+    for (const auto& [name, codec] : {pair{"plain"s, PostingCodec::PLAIN}, pair{"varint"s, PostingCodec::VARINT}}) {
+        search_server.SetPostingCodec(codec);
+        cout << name << " postings: "s << search_server.GetIndexMemoryUsage() / 1024 << " KiB"s << endl;
+        Test(name, search_server, queries, execution::seq);
+        TestPrunedSearch(name + ", pruned"s, search_server, queries);
+    }
+}
+void TestTokenizerThroughput(const vector<string>& documents) {
+    string text;
+    for (const string& document : documents) {
+        text += document;
+        text += ' ';
+    }
+    vector<string_view> words;
+    for (const TokenizerKernel kernel : {TokenizerKernel::SCALAR, TokenizerKernel::SSE2, TokenizerKernel::AVX2}) {
+        if (!IsTokenizerKernelSupported(kernel)) {
+            continue;
+        }
+        const int repeat_count = 20;
+        size_t word_count = 0;
+        const auto start = chrono::steady_clock::now();
+        for (int i = 0; i < repeat_count; ++i) {
+            SplitIntoValidWords(kernel, text, words);
+            word_count += words.size();
+        }
+        const chrono::duration<double> seconds = chrono::steady_clock::now() - start;
+        cerr << "tokenizer, kernel = "s << static_cast<int>(kernel) << ": "s
+             << static_cast<int>(text.size() * repeat_count / seconds.count() / (1 << 20)) << " MB/s, "s
+             << word_count / repeat_count << " words"s << endl;
+    }
+}
+
+// Ядро подсчёта релевантности отдельно от разбора запросов и сортировки: синтетические списки вхождений
+// раскладываются в плотные накопители, затем собираются совпавшие слоты.
+void BenchmarkScoringKernels() {
+    mt19937 generator(23);
+    const size_t slot_count = 100'000;
+    vector<double> inv_word_counts(slot_count);
+    for (double& inv_word_count : inv_word_counts) {
+        inv_word_count = 1.0 / uniform_int_distribution<int>(1, 100)(generator);
+    }
+    vector<vector<int>> term_slots(20);
+    vector<vector<uint32_t>> term_counts(term_slots.size());
+    for (size_t term = 0; term < term_slots.size(); ++term) {
+        for (size_t slot = 0; slot < slot_count; ++slot) {
+            if (uniform_int_distribution<int>(0, 9)(generator) == 0) {
+                term_slots[term].push_back(static_cast<int>(slot));
+                term_counts[term].push_back(uniform_int_distribution<uint32_t>(1, 5)(generator));
+            }
+        }
+    }
+    SlotBitmap excluded_slots(slot_count);
+    for (size_t slot = 0; slot < slot_count; slot += 7) {
+        excluded_slots.Set(static_cast<int>(slot));
+    }
+
+    const int repeat_count = 50;
+    vector<double> relevances(slot_count);
+    vector<uint8_t> is_matched(slot_count);
+    size_t posting_count = 0;
+    chrono::duration<double> accumulate_seconds{0};
+    for (int i = 0; i < repeat_count; ++i) {
+        fill(relevances.begin(), relevances.end(), 0.0);
+        fill(is_matched.begin(), is_matched.end(), 0);
+        const auto start = chrono::steady_clock::now();
+        for (size_t term = 0; term < term_slots.size(); ++term) {
+            // блоками, как их отдаёт PostingList::ForEachBlock
+            for (size_t first = 0; first < term_slots[term].size(); first += PostingList::BLOCK_SIZE) {
+                const size_t size = min(PostingList::BLOCK_SIZE, term_slots[term].size() - first);
+                AccumulateTermScores(term_slots[term].data() + first, term_counts[term].data() + first, size, excluded_slots,
+                                     TfIdfTermScore{inv_word_counts.data(), 1.0 + term * 0.1}, relevances.data(), is_matched.data());
+            }
+            posting_count += term_slots[term].size();
+        }
+        accumulate_seconds += chrono::steady_clock::now() - start;
+    }
+    cerr << "scoring, accumulate "s << static_cast<int>(posting_count / accumulate_seconds.count() / 1e6) << " M postings/s"s << endl;
+
+    vector<int> matched_slots;
+    for (const ScoringKernel kernel : {ScoringKernel::SCALAR, ScoringKernel::AVX2, ScoringKernel::AVX512}) {
+        if (!IsScoringKernelSupported(kernel)) {
+            continue;
+        }
+        double total_relevance = 0;
+        chrono::duration<double> collect_seconds{0};
+        for (int i = 0; i < repeat_count; ++i) {
+            const auto start = chrono::steady_clock::now();
+            matched_slots.clear();
+            CollectMatchedSlots(kernel, is_matched.data(), slot_count, excluded_slots, matched_slots);
+            collect_seconds += chrono::steady_clock::now() - start;
+            for (const int slot : matched_slots) {
+                total_relevance += relevances[slot];
+            }
+        }
+        cerr << "scoring, kernel = "s << static_cast<int>(kernel) << ": collect "s
+             << static_cast<int>(slot_count * repeat_count / collect_seconds.count() / 1e6) << " M slots/s, "s
+             << matched_slots.size() << " matched, "s << total_relevance / repeat_count << endl;
+    }
+}
+
+void TestStopWordLookup(const vector<string>& dictionary, const vector<string>& documents) {
+    const vector<string> stop_words(dictionary.begin(), dictionary.begin() + 100);
+    vector<string_view> tokens;
+    for (const string& document : documents) {
+        for (const string_view word : SplitIntoWords(document)) {
+            tokens.push_back(word);
+        }
+    }
+
+    const auto measure = [&tokens](string_view mark, auto is_stop_word) {
+        const int repeat_count = 10;
+        size_t stop_word_count = 0;
+        const auto start = chrono::steady_clock::now();
+        for (int i = 0; i < repeat_count; ++i) {
+            for (const string_view token : tokens) {
+                stop_word_count += is_stop_word(token) ? 1 : 0;
+            }
+        }
+        const chrono::duration<double, nano> duration = chrono::steady_clock::now() - start;
+        cerr << "stop words, "s << mark << ": "s << duration.count() / (tokens.size() * repeat_count) << " ns/token, "s
+             << stop_word_count / repeat_count << " stop words"s << endl;
+    };
+
+    const set<string> ordered_set(stop_words.begin(), stop_words.end());
+    measure("std::set<std::string>"s, [&ordered_set](string_view word) {
+        return ordered_set.count(static_cast<string>(word)) > 0;
+    });
+    const FrozenStringSet frozen_set(stop_words);
+    measure("FrozenStringSet"s, [&frozen_set](string_view word) {
+        return frozen_set.Contains(word);
+    });
+}
+
+void TestBulkIngest(const string& stop_words, const vector<string>& documents) {
+    vector<tuple<int, string_view, DocumentStatus, vector<int>>> batch;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        batch.emplace_back(i, documents[i], DocumentStatus::ACTUAL, vector<int>{1, 2, 3});
+    }
+    {
+        SearchServer search_server(stop_words);
+        LOG_DURATION("ingest, AddDocument loop"s);
+        for (const auto& [id, text, status, ratings] : batch) {
+            search_server.AddDocument(id, text, status, ratings);
+        }
+    }
+    const size_t max_thread_count = max(1u, thread::hardware_concurrency());
+    for (size_t thread_count = 1; thread_count <= max_thread_count; thread_count *= 2) {
+        SearchServer search_server(stop_words);
+        search_server.SetThreadCount(thread_count);
+        LOG_DURATION("ingest, AddDocuments(par), threads = "s + to_string(thread_count));
+        search_server.AddDocuments(execution::par, batch);
+    }
+}
+
+void TestSnapshotStartup(const string& stop_words, const vector<string>& documents, const vector<string>& queries) {
+    const string path = "search_server.snapshot"s;
+    {
+        LOG_DURATION("startup, AddDocument"s);
+        SearchServer search_server(stop_words);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        search_server.SaveSnapshot(path);
+    }
+    {
+        LOG_DURATION("startup, mmap snapshot"s);
+        MappedSearchServer search_server(path);
+        cerr << "snapshot documents: "s << search_server.GetDocumentCount() << endl;
+    }
+    {
+        MappedSearchServer search_server(path);
+        LOG_DURATION("mapped, queries"s);
+        double total_relevance = 0;
+        for (const string_view query : queries) {
+            for (const auto& document : search_server.FindTopDocuments(query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        cerr << total_relevance << endl;
+    }
+    remove(path.c_str());
+}
+
+void TestRequestCache(const SearchServer& search_server, const vector<string>& queries) {
+    // запросы повторяются по закону Ципфа: i-й по популярности встречается в ~1/i раз реже первого
+    mt19937 generator;
+    vector<double> weights;
+    for (size_t i = 1; i <= queries.size(); ++i) {
+        weights.push_back(1.0 / i);
+    }
+    discrete_distribution<size_t> popularity(weights.begin(), weights.end());
+    vector<const string*> traffic;
+    for (int i = 0; i < 5'000; ++i) {
+        traffic.push_back(&queries[popularity(generator)]);
+    }
+
+    {
+        LOG_DURATION("requests, no cache"s);
+        RequestQueue request_queue(search_server, 0);
+        for (const string* query : traffic) {
+            request_queue.AddFindRequest(*query);
+        }
+    }
+    {
+        RequestQueue request_queue(search_server);
+        {
+            LOG_DURATION("requests, LRU cache"s);
+            for (const string* query : traffic) {
+                request_queue.AddFindRequest(*query);
+            }
+        }
+        cerr << "cache hit rate: "s << request_queue.GetCacheStats().GetHitRate() << endl;
+    }
+}
+
+void TestBatchQueries(string_view mark, const SearchServer& search_server, const vector<string>& queries) {
+    vector<vector<Document>> single_results;
+    {
+        LOG_DURATION(string(mark) + ", ProcessQueries"s);
+        single_results = ProcessQueries(search_server, queries);
+    }
+    vector<vector<Document>> batch_results;
+    {
+        LOG_DURATION(string(mark) + ", FindTopDocumentsBatch"s);
+        batch_results = search_server.FindTopDocumentsBatch(queries);
+    }
+    size_t mismatches = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        mismatches += batch_results[i].size() != single_results[i].size() ? 1 : 0;
+    }
+    cerr << "batch mismatches: "s << mismatches << endl;
+}
+
+void TestJoinedQueries(const SearchServer& search_server, const vector<string>& queries) {
+    size_t joined_count = 0;
+    {
+        LOG_DURATION("ProcessQueriesJoined"s);
+        joined_count = ProcessQueriesJoined(search_server, queries).size();
+    }
+    size_t streamed_count = 0;
+    {
+        LOG_DURATION("ProcessQueriesStream"s);
+        const auto start = chrono::steady_clock::now();
+        QueryResultStream stream = ProcessQueriesStream(search_server, queries);
+        auto it = stream.begin();
+        cerr << "first streamed result after "s
+             << chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count() << " us"s << endl;
+        for (; it != stream.end(); ++it) {
+            ++streamed_count;
+        }
+    }
+    cerr << "joined: "s << joined_count << ", streamed: "s << streamed_count << endl;
+}
+
+// прежняя ConcurrentMap - std::map под мьютексом в каждой корзине; оставлена как база для сравнения
+template <typename Key, typename Value>
+class BucketConcurrentMap {
+public:
+    struct Access {
+        lock_guard<mutex> guard;
+        Value& ref_to_value;
+    };
+
+    explicit BucketConcurrentMap(size_t bucket_count)
+        : buckets_(bucket_count) {
+    }
+
+    Access operator[](const Key& key) {
+        auto& bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
+        return Access{lock_guard<mutex>(bucket.m), bucket.dict[key]};
+    }
+
+private:
+    struct Bucket {
+        map<Key, Value> dict;
+        mutex m;
+    };
+
+    vector<Bucket> buckets_;
+};
+
+template <typename Map>
+void TestMapContention(string_view mark, int key_count, size_t thread_count) {
+    const int operation_count = 2'000'000;
+    Map counters(64);
+    LOG_DURATION(string(mark) + ", keys = "s + to_string(key_count) + ", threads = "s + to_string(thread_count));
+    vector<future<void>> workers;
+    for (size_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+        workers.push_back(async(launch::async, [&counters, key_count, thread_count, thread_index] {
+            mt19937 generator(thread_index);
+            uniform_int_distribution<int> key_distribution(0, key_count - 1);
+            for (size_t i = 0; i < operation_count / thread_count; ++i) {
+                ++counters[key_distribution(generator)].ref_to_value;
+            }
+        }));
+    }
+    for (auto& worker : workers) {
+        worker.get();
+    }
+}
+void TestConcurrentMapContention(int key_count, size_t thread_count) {
+    TestMapContention<BucketConcurrentMap<int, int>>("BucketConcurrentMap"s, key_count, thread_count);
+    TestMapContention<ConcurrentMap<int, int>>("ConcurrentMap"s, key_count, thread_count);
+}
 void PrintDocument(const Document& document) {
     cout << "{ "s
          << "document_id = "s << document.id << ", "s
          << "relevance = "s << document.relevance << ", "s
          << "rating = "s << document.rating << " }"s << endl;
 }
-int main() {
+void RunBenchmarks(mt19937& generator, const vector<string>& dictionary, const vector<string>& documents, SearchServer& search_server,
+                   const vector<string>& queries) {
+    TestTokenizerThroughput(documents);
+    BenchmarkScoringKernels();
+    TestStopWordLookup(dictionary, documents);
+    TestBulkIngest(dictionary[0], documents);
+    Test("seq"s, search_server, queries, execution::seq);
+    TestRankingModel<Bm25Ranking>("seq, BM25"s, search_server, queries);
+    Test("par"s, search_server, queries, execution::par);
+    TestSnapshotStartup(dictionary[0], documents, queries);
+    TestBatchQueries("70 words"s, search_server, queries);
+    TestParallelScaling(search_server, queries);
+    TestShardedSearch(dictionary[0], documents, queries);
+    TestSegmentedIngest(dictionary[0], documents, queries);
+    TestPrunedSearch("pruned"s, search_server, queries);
+    TestMinusWordQueries(search_server, dictionary);
+    {
+        const auto short_queries = GenerateQueries(generator, dictionary, 1000, 3);
+        Test("seq, 3 words"s, search_server, short_queries, execution::seq);
+        TestIndexedPredicates(search_server, short_queries);
+        TestQueryContext(search_server, short_queries);
+        TestRankingModel<TfIdfRanking>("ranking, TF-IDF"s, search_server, short_queries);
+        TestRankingModel<Bm25Ranking>("ranking, BM25"s, search_server, short_queries);
+        TestPrunedSearch("pruned, 3 words"s, search_server, short_queries);
+        TestPostingCodecs(search_server, short_queries);
+        TestImpactSearch(search_server, short_queries);
+        TestRequestCache(search_server, short_queries);
+        TestBatchQueries("3 words"s, search_server, short_queries);
+        TestJoinedQueries(search_server, short_queries);
+    }
+
+    for (const int key_count : {100, 10'000, 1'000'000}) {
+        for (size_t thread_count = 1; thread_count <= max(1u, thread::hardware_concurrency()); thread_count *= 2) {
+            TestConcurrentMapContention(key_count, thread_count);
+        }
+    }
+}
+int main(int argc, char* argv[]) {
+    TestSearchServer();
     SearchServer search_server("and with"s);
     int id = 0;
     for (
@@ -108,5 +645,10 @@ int main() {
     TEST(seq);
     TEST(par);
 
+    // замеры отдельных оптимизаций идут несколько минут, поэтому только по флагу
+    if (argc > 1 && argv[1] == "--benchmarks"s) {
+        RunBenchmarks(generator, dictionary, documents, search_server2, queries);
+    }
+
     return 0;
 }
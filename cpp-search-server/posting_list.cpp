@@ -0,0 +1,435 @@
+#include "posting_list.h"
+
+#include <algorithm>
+
+namespace
+{
+void WriteVarint(uint32_t value, std::vector<uint8_t>& bytes)
+{
+    while (value >= 0x80)
+    {
+        bytes.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t ReadVarint(const uint8_t*& data)
+{
+    uint32_t value = 0;
+    for (int shift = 0;; shift += 7)
+    {
+        const uint8_t byte = *data++;
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+}
+
+// число байтов сжатого блока: разности слотов и частоты - 2 * size - 1 чисел varint
+size_t GetEncodedSize(const PostingList::BlockInfo& info, const uint8_t* bytes)
+{
+    const uint8_t* begin = bytes + info.offset;
+    const uint8_t* data = begin;
+    for (uint32_t i = 1; i < 2 * info.size; ++i)
+    {
+        ReadVarint(data);
+    }
+    return data - begin;
+}
+}
+
+//--------------------PostingList::Cursor------------------//
+PostingList::Cursor::Cursor(const PostingList& postings)
+    : postings_(&postings)
+{
+    LoadBlock(0);
+}
+
+PostingList::Cursor::Cursor(const Cursor& other)
+{
+    *this = other;
+}
+
+PostingList::Cursor& PostingList::Cursor::operator=(const Cursor& other)
+{
+    postings_ = other.postings_;
+    block_index_ = other.block_index_;
+    position_ = other.position_;
+    block_ = other.block_;
+    is_loaded_ = other.is_loaded_;
+    slot_buffer_ = other.slot_buffer_;
+    count_buffer_ = other.count_buffer_;
+    // раскодированный блок должен указывать на собственные буферы копии
+    if (other.block_.slots == other.slot_buffer_.data())
+    {
+        block_.slots = slot_buffer_.data();
+        block_.counts = count_buffer_.data();
+    }
+    return *this;
+}
+
+void PostingList::Cursor::LoadBlock(size_t block_index)
+{
+    block_index_ = block_index;
+    position_ = 0;
+    is_loaded_ = true;
+    if (block_index < postings_->GetBlockCount())
+    {
+        block_ = postings_->DecodeBlock(block_index, slot_buffer_.data(), count_buffer_.data());
+    }
+}
+
+bool PostingList::Cursor::AtEnd() const
+{
+    return block_index_ >= postings_->GetBlockCount();
+}
+
+int PostingList::Cursor::Slot() const
+{
+    return block_.slots[position_];
+}
+
+uint32_t PostingList::Cursor::Count() const
+{
+    return block_.counts[position_];
+}
+
+void PostingList::Cursor::Next()
+{
+    if (++position_ == block_.size)
+    {
+        LoadBlock(block_index_ + 1);
+    }
+}
+
+void PostingList::Cursor::Seek(int slot)
+{
+    SeekBlock(slot);
+    if (AtEnd())
+    {
+        return;
+    }
+    if (!is_loaded_)
+    {
+        LoadBlock(block_index_);
+    }
+    position_ = std::lower_bound(block_.slots + position_, block_.slots + block_.size, slot) - block_.slots;
+}
+
+void PostingList::Cursor::SeekBlock(int slot)
+{
+    if (AtEnd() || (is_loaded_ && block_.slots[position_] >= slot) || postings_->GetBlockLastSlot(block_index_) >= slot)
+    {
+        return;
+    }
+
+    // блоки, целиком лежащие левее slot, пропускаются без раскодирования
+    size_t block_index = block_index_ + 1;
+    while (block_index < postings_->GetBlockCount() && postings_->GetBlockLastSlot(block_index) < slot)
+    {
+        ++block_index;
+    }
+    block_index_ = block_index;
+    position_ = 0;
+    is_loaded_ = false;
+}
+
+double PostingList::Cursor::GetBlockMaxTermFreq() const
+{
+    return AtEnd() ? 0.0 : postings_->GetBlockMaxTermFreq(block_index_);
+}
+
+//--------------------PostingList------------------//
+PostingList::PostingList(PostingCodec codec)
+    : codec_(codec){}
+
+void PostingList::Add(int slot, uint32_t count, double term_freq)
+{
+    max_term_freq_ = std::max(max_term_freq_, term_freq);
+    if (count > 0)
+    {
+        max_freq_per_count_ = std::max(max_freq_per_count_, term_freq / count);
+    }
+
+    const size_t block_index = FindBlock(slot);
+    if (block_index == blocks_.size())
+    {
+        // новые документы обычно получают слот в конце, поэтому сначала пробуем дописать в конец
+        if (slots_.empty() || slots_.back() < slot)
+        {
+            slots_.push_back(slot);
+            counts_.push_back(count);
+        }
+        else
+        {
+            const auto it = std::lower_bound(slots_.begin(), slots_.end(), slot);
+            const auto pos = it - slots_.begin();
+            if (*it == slot)
+            {
+                counts_[pos] += count;
+                return;
+            }
+            slots_.insert(it, slot);
+            counts_.insert(counts_.begin() + pos, count);
+        }
+        ++size_;
+
+        if (codec_ == PostingCodec::VARINT && slots_.size() >= BLOCK_SIZE)
+        {
+            FlushTail();
+        }
+        return;
+    }
+
+    std::vector<int> slots;
+    std::vector<uint32_t> counts;
+    DecodeBlock(block_index, slots, counts);
+    const auto it = std::lower_bound(slots.begin(), slots.end(), slot);
+    const auto pos = it - slots.begin();
+    if (it != slots.end() && *it == slot)
+    {
+        counts[pos] += count;
+    }
+    else
+    {
+        slots.insert(it, slot);
+        counts.insert(counts.begin() + pos, count);
+        ++size_;
+    }
+    ReplaceBlock(block_index, slots, counts);
+}
+
+bool PostingList::Remove(int slot)
+{
+    const size_t block_index = FindBlock(slot);
+    if (block_index == blocks_.size())
+    {
+        const auto it = std::lower_bound(slots_.begin(), slots_.end(), slot);
+        if (it == slots_.end() || *it != slot)
+        {
+            return false;
+        }
+        counts_.erase(counts_.begin() + (it - slots_.begin()));
+        slots_.erase(it);
+        --size_;
+        return true;
+    }
+
+    std::vector<int> slots;
+    std::vector<uint32_t> counts;
+    DecodeBlock(block_index, slots, counts);
+    const auto it = std::lower_bound(slots.begin(), slots.end(), slot);
+    if (it == slots.end() || *it != slot)
+    {
+        return false;
+    }
+    counts.erase(counts.begin() + (it - slots.begin()));
+    slots.erase(it);
+    --size_;
+    ReplaceBlock(block_index, slots, counts);
+    return true;
+}
+
+bool PostingList::Contains(int slot) const
+{
+    const size_t block_index = FindBlock(slot);
+    if (block_index == blocks_.size())
+    {
+        return std::binary_search(slots_.begin(), slots_.end(), slot);
+    }
+
+    std::array<int, MAX_BLOCK_SIZE> slot_buffer;
+    std::array<uint32_t, MAX_BLOCK_SIZE> count_buffer;
+    const Block block = DecodeBlock(block_index, slot_buffer.data(), count_buffer.data());
+    return std::binary_search(block.slots, block.slots + block.size, slot);
+}
+
+size_t PostingList::size() const
+{
+    return size_;
+}
+
+bool PostingList::empty() const
+{
+    return size_ == 0;
+}
+
+double PostingList::GetMaxTermFreq() const
+{
+    return max_term_freq_;
+}
+
+PostingCodec PostingList::GetCodec() const
+{
+    return codec_;
+}
+
+void PostingList::SetCodec(PostingCodec codec)
+{
+    std::vector<int> slots;
+    std::vector<uint32_t> counts;
+    slots.reserve(size_);
+    counts.reserve(size_);
+    ForEachBlock([&slots, &counts](const Block& block)
+    {
+        slots.insert(slots.end(), block.slots, block.slots + block.size);
+        counts.insert(counts.end(), block.counts, block.counts + block.size);
+    });
+
+    codec_ = codec;
+    blocks_.clear();
+    block_max_counts_.clear();
+    bytes_.clear();
+    garbage_bytes_ = 0;
+    slots_ = std::move(slots);
+    counts_ = std::move(counts);
+    if (codec_ == PostingCodec::VARINT)
+    {
+        FlushTail();
+    }
+    slots_.shrink_to_fit();
+    counts_.shrink_to_fit();
+    blocks_.shrink_to_fit();
+    block_max_counts_.shrink_to_fit();
+    bytes_.shrink_to_fit();
+}
+
+size_t PostingList::GetMemoryUsage() const
+{
+    return sizeof(*this)
+        + slots_.capacity() * sizeof(int)
+        + counts_.capacity() * sizeof(uint32_t)
+        + blocks_.capacity() * sizeof(BlockInfo)
+        + block_max_counts_.capacity() * sizeof(uint32_t)
+        + bytes_.capacity();
+}
+
+size_t PostingList::GetBlockCount() const
+{
+    return blocks_.size() + (slots_.empty() ? 0 : 1);
+}
+
+int PostingList::GetBlockLastSlot(size_t block_index) const
+{
+    return block_index < blocks_.size() ? blocks_[block_index].last_slot : slots_.back();
+}
+
+double PostingList::GetBlockMaxTermFreq(size_t block_index) const
+{
+    return block_index < blocks_.size() ? std::min(max_term_freq_, block_max_counts_[block_index] * max_freq_per_count_) : max_term_freq_;
+}
+
+PostingList::Block PostingList::DecodeBlock(size_t block_index, int* slot_buffer, uint32_t* count_buffer) const
+{
+    if (block_index == blocks_.size())
+    {
+        return { slots_.data(), counts_.data(), slots_.size() };
+    }
+
+    return DecodeBlock(blocks_[block_index], bytes_.data(), slot_buffer, count_buffer);
+}
+
+PostingList::Block PostingList::DecodeBlock(const BlockInfo& info, const uint8_t* bytes, int* slot_buffer, uint32_t* count_buffer)
+{
+    const uint8_t* data = bytes + info.offset;
+    slot_buffer[0] = info.first_slot;
+    for (uint32_t i = 1; i < info.size; ++i)
+    {
+        slot_buffer[i] = slot_buffer[i - 1] + static_cast<int>(ReadVarint(data));
+    }
+    for (uint32_t i = 0; i < info.size; ++i)
+    {
+        count_buffer[i] = ReadVarint(data);
+    }
+    return { slot_buffer, count_buffer, info.size };
+}
+
+PostingList::BlockInfo PostingList::EncodeBlock(const int* slots, const uint32_t* counts, size_t size, std::vector<uint8_t>& bytes)
+{
+    const BlockInfo info = { slots[0], slots[size - 1], static_cast<uint32_t>(size), static_cast<uint32_t>(bytes.size()) };
+    for (size_t i = 1; i < size; ++i)
+    {
+        WriteVarint(static_cast<uint32_t>(slots[i] - slots[i - 1]), bytes);
+    }
+    for (size_t i = 0; i < size; ++i)
+    {
+        WriteVarint(counts[i], bytes);
+    }
+    return info;
+}
+
+size_t PostingList::FindBlock(int slot) const
+{
+    // первый сжатый блок, который может содержать slot; blocks_.size() означает несжатый хвост
+    return std::lower_bound(blocks_.begin(), blocks_.end(), slot, [](const BlockInfo& info, int slot)
+    {
+        return info.last_slot < slot;
+    }) - blocks_.begin();
+}
+
+void PostingList::DecodeBlock(size_t block_index, std::vector<int>& slots, std::vector<uint32_t>& counts) const
+{
+    slots.resize(blocks_[block_index].size);
+    counts.resize(blocks_[block_index].size);
+    DecodeBlock(block_index, slots.data(), counts.data());
+}
+
+void PostingList::ReplaceBlock(size_t block_index, const std::vector<int>& slots, const std::vector<uint32_t>& counts)
+{
+    // Новые байты дописываются в конец буфера, а старые остаются мусором, пока его не наберётся половина буфера:
+    // изменение блока стоит O(размера блока), а не O(размера списка).
+    garbage_bytes_ += GetEncodedSize(blocks_[block_index], bytes_.data());
+
+    // слишком большой блок делится на равные части, пустой - удаляется
+    const size_t chunk_count = slots.size() <= MAX_BLOCK_SIZE ? (slots.empty() ? 0 : 1) : (slots.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    std::vector<BlockInfo> infos;
+    std::vector<uint32_t> max_counts;
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk)
+    {
+        const size_t begin = slots.size() * chunk / chunk_count;
+        const size_t end = slots.size() * (chunk + 1) / chunk_count;
+        infos.push_back(EncodeBlock(slots.data() + begin, counts.data() + begin, end - begin, bytes_));
+        max_counts.push_back(*std::max_element(counts.begin() + begin, counts.begin() + end));
+    }
+
+    blocks_.erase(blocks_.begin() + block_index);
+    blocks_.insert(blocks_.begin() + block_index, infos.begin(), infos.end());
+    block_max_counts_.erase(block_max_counts_.begin() + block_index);
+    block_max_counts_.insert(block_max_counts_.begin() + block_index, max_counts.begin(), max_counts.end());
+
+    if (garbage_bytes_ * 2 > bytes_.size())
+    {
+        CompactBytes();
+    }
+}
+
+void PostingList::CompactBytes()
+{
+    std::vector<uint8_t> bytes;
+    bytes.reserve(bytes_.size() - garbage_bytes_);
+    for (BlockInfo& info : blocks_)
+    {
+        const auto begin = bytes_.begin() + info.offset;
+        const size_t size = GetEncodedSize(info, bytes_.data());
+        info.offset = static_cast<uint32_t>(bytes.size());
+        bytes.insert(bytes.end(), begin, begin + size);
+    }
+    bytes_ = std::move(bytes);
+    garbage_bytes_ = 0;
+}
+
+void PostingList::FlushTail()
+{
+    // сжимаются только полные блоки, остаток остаётся несжатым хвостом
+    const size_t full_size = slots_.size() / BLOCK_SIZE * BLOCK_SIZE;
+    for (size_t begin = 0; begin < full_size; begin += BLOCK_SIZE)
+    {
+        blocks_.push_back(EncodeBlock(slots_.data() + begin, counts_.data() + begin, BLOCK_SIZE, bytes_));
+        block_max_counts_.push_back(*std::max_element(counts_.begin() + begin, counts_.begin() + begin + BLOCK_SIZE));
+    }
+    slots_.erase(slots_.begin(), slots_.begin() + full_size);
+    counts_.erase(counts_.begin(), counts_.begin() + full_size);
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Формат хранения списка вхождений.
+// PLAIN - несжатые массивы слотов и частот; VARINT - блоки по BLOCK_SIZE вхождений,
+// слоты закодированы разностями, разности и частоты - varint.
+enum class PostingCodec
+{
+    PLAIN,
+    VARINT,
+};
+
+// Список вхождений терма, упорядоченный по слоту документа. Для каждого документа хранится число вхождений
+// терма (count); частота терма восстанавливается как count / число слов документа.
+class PostingList
+{
+public:
+    static constexpr size_t BLOCK_SIZE = 128;
+    static constexpr size_t MAX_BLOCK_SIZE = 2 * BLOCK_SIZE;
+
+    // Сжатый блок: offset - смещение его байтов от начала буфера списка.
+    struct BlockInfo
+    {
+        int first_slot;
+        int last_slot;
+        uint32_t size;
+        uint32_t offset;
+    };
+
+    // Раскодированный кусок списка.
+    struct Block
+    {
+        const int* slots;
+        const uint32_t* counts;
+        size_t size;
+    };
+
+    // Последовательный проход по списку с пропуском целых блоков при поиске.
+    class Cursor
+    {
+    private:
+        const PostingList* postings_;
+        size_t block_index_ = 0;
+        size_t position_ = 0;
+        Block block_ = { nullptr, nullptr, 0 };
+        // после SeekBlock текущий блок ещё не раскодирован
+        bool is_loaded_ = false;
+        std::array<int, MAX_BLOCK_SIZE> slot_buffer_;
+        std::array<uint32_t, MAX_BLOCK_SIZE> count_buffer_;
+
+        void LoadBlock(size_t block_index);
+
+    public:
+        explicit Cursor(const PostingList& postings);
+        Cursor(const Cursor& other);
+        Cursor& operator=(const Cursor& other);
+
+        bool AtEnd() const;
+        int Slot() const;
+        uint32_t Count() const;
+        void Next();
+        // переходит к первому вхождению со слотом не меньше slot
+        void Seek(int slot);
+        // переходит к блоку, который может содержать slot, не раскодируя его; Slot и Count доступны только после Seek
+        void SeekBlock(int slot);
+        // верхняя граница частоты терма в текущем блоке
+        double GetBlockMaxTermFreq() const;
+        // передаёт function(slot, count) вхождения со слотом меньше end и останавливается на первом из остальных
+        template <typename Function>
+        void ForEachBefore(int end, Function function);
+    };
+
+    explicit PostingList(PostingCodec codec = PostingCodec::PLAIN);
+
+    // term_freq используется только для верхней границы частоты терма
+    void Add(int slot, uint32_t count, double term_freq);
+    bool Remove(int slot);
+    bool Contains(int slot) const;
+    size_t size() const;
+    bool empty() const;
+
+    // Верхняя граница частоты терма: при удалении документов не уменьшается, но остаётся оценкой сверху.
+    double GetMaxTermFreq() const;
+
+    PostingCodec GetCodec() const;
+    void SetCodec(PostingCodec codec);
+    size_t GetMemoryUsage() const;
+
+    size_t GetBlockCount() const;
+    int GetBlockLastSlot(size_t block_index) const;
+    // Для сжатого блока граница считается по наибольшему count в нём, для несжатых данных совпадает с GetMaxTermFreq.
+    double GetBlockMaxTermFreq(size_t block_index) const;
+    // Для сжатого блока раскодирует его в буферы размером не меньше MAX_BLOCK_SIZE, несжатые данные отдаёт напрямую.
+    Block DecodeBlock(size_t block_index, int* slot_buffer, uint32_t* count_buffer) const;
+
+    template <typename Function>
+    void ForEachBlock(Function function) const;
+
+    // Формат сжатого блока, общий для списков в памяти и снимков индекса.
+    static BlockInfo EncodeBlock(const int* slots, const uint32_t* counts, size_t size, std::vector<uint8_t>& bytes);
+    static Block DecodeBlock(const BlockInfo& info, const uint8_t* bytes, int* slot_buffer, uint32_t* count_buffer);
+
+private:
+    PostingCodec codec_;
+    size_t size_ = 0;
+    double max_term_freq_ = 0.0;
+    // наибольшее отношение term_freq / count, то есть 1 / длина самого короткого документа списка
+    double max_freq_per_count_ = 0.0;
+
+    // PLAIN: весь список лежит в slots_/counts_.
+    // VARINT: полные блоки сжаты в bytes_, последние (меньше BLOCK_SIZE) вхождения лежат несжатыми в slots_/counts_.
+    std::vector<int> slots_;
+    std::vector<uint32_t> counts_;
+    std::vector<BlockInfo> blocks_;
+    // наибольший count в каждом сжатом блоке
+    std::vector<uint32_t> block_max_counts_;
+    // блоки лежат в bytes_ не обязательно по порядку; garbage_bytes_ - байты заменённых блоков
+    std::vector<uint8_t> bytes_;
+    size_t garbage_bytes_ = 0;
+
+    size_t FindBlock(int slot) const;
+    void DecodeBlock(size_t block_index, std::vector<int>& slots, std::vector<uint32_t>& counts) const;
+    void ReplaceBlock(size_t block_index, const std::vector<int>& slots, const std::vector<uint32_t>& counts);
+    void CompactBytes();
+    void FlushTail();
+};
+
+template <typename Function>
+void PostingList::Cursor::ForEachBefore(int end, Function function)
+{
+    while (!AtEnd())
+    {
+        if (!is_loaded_)
+        {
+            LoadBlock(block_index_);
+        }
+        for (; position_ < block_.size && block_.slots[position_] < end; ++position_)
+        {
+            function(block_.slots[position_], block_.counts[position_]);
+        }
+        if (position_ < block_.size)
+        {
+            return;
+        }
+        LoadBlock(block_index_ + 1);
+    }
+}
+
+template <typename Function>
+void PostingList::ForEachBlock(Function function) const
+{
+    std::array<int, MAX_BLOCK_SIZE> slot_buffer;
+    std::array<uint32_t, MAX_BLOCK_SIZE> count_buffer;
+    for (size_t block_index = 0; block_index < GetBlockCount(); ++block_index)
+    {
+        function(DecodeBlock(block_index, slot_buffer.data(), count_buffer.data()));
+    }
+}
@@ -1,27 +1,135 @@
 #include "process_queries.h"
-#include <list>
+#include <algorithm>
+#include <numeric>
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
     const std::vector<std::string>& queries)
 {
-    std::vector<std::vector<Document>> doc_to_return(queries.size()) ;
-    std::transform(std::execution::par, (queries.begin()), queries.end(), doc_to_return.begin(), [&search_server](const std::string & str)
-   {
-       return search_server.FindTopDocuments(str);
-   });
+    // Запросы считаются независимо: плотные накопители FindTopDocumentsBatch (слот x запрос) на замерах медленнее
+    // даже при сотне запросов на терм, поэтому пакетный поиск остаётся отдельным методом сервера.
+    std::vector<std::vector<Document>> doc_to_return(queries.size());
+    std::transform(std::execution::par, queries.begin(), queries.end(), doc_to_return.begin(), [&search_server](const std::string& query)
+    {
+        return search_server.FindTopDocuments(query);
+    });
+    return doc_to_return;
+}
+
+std::vector<Document> ProcessQueriesJoined(const SearchServer &search_server, const std::vector<std::string> &queries)
+{
+    // запросы считаются независимо, как в ProcessQueries; здесь только раскладываются по общему буферу
+    const std::vector<std::vector<Document>> results = ProcessQueries(search_server, queries);
+
+    std::vector<size_t> offsets(results.size() + 1);
+    std::transform_exclusive_scan(std::execution::par, results.begin(), results.end(), offsets.begin(), size_t{0}, std::plus<>{},
+    [](const std::vector<Document>& documents)
+    {
+        return documents.size();
+    });
+    offsets.back() = results.empty() ? 0 : offsets[results.size() - 1] + results.back().size();
+
+    std::vector<Document> doc_to_return(offsets.back());
+    std::vector<size_t> indexes(results.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t index)
+    {
+        std::copy(results[index].begin(), results[index].end(), doc_to_return.begin() + offsets[index]);
+    });
+    return doc_to_return;
+}
+
+//--------------------QueryResultStream::Iterator------------------//
+QueryResultStream::Iterator::Iterator(QueryResultStream* stream)
+    : stream_(stream){}
+
+QueryResultStream::Iterator::reference QueryResultStream::Iterator::operator*() const
+{
+    return stream_->current_[stream_->position_];
+}
+
+QueryResultStream::Iterator::pointer QueryResultStream::Iterator::operator->() const
+{
+    return &**this;
+}
+
+QueryResultStream::Iterator& QueryResultStream::Iterator::operator++()
+{
+    if (!stream_->Advance())
+    {
+        stream_ = nullptr;
+    }
+    return *this;
+}
+
+bool QueryResultStream::Iterator::operator==(const Iterator& other) const
+{
+    return stream_ == other.stream_;
+}
 
-   return doc_to_return;
+bool QueryResultStream::Iterator::operator!=(const Iterator& other) const
+{
+    return stream_ != other.stream_;
 }
 
-std::list<Document> ProcessQueriesJoined(const SearchServer &search_server, const std::vector<std::string> &queries)
+//--------------------QueryResultStream------------------//
+QueryResultStream::QueryResultStream(const SearchServer& search_server, const std::vector<std::string>& queries, size_t prefetch)
+    : search_server_(search_server), queries_(queries), prefetch_(std::max<size_t>(prefetch, 1)){}
+
+void QueryResultStream::Launch()
 {
-    std::list<Document> doc_to_return;
+    while (pending_.size() < prefetch_ && next_query_ < queries_.size())
+    {
+        pending_.push_back(std::async(std::launch::async, [this, query = next_query_]
+        {
+            return search_server_.FindTopDocuments(queries_[query]);
+        }));
+        ++next_query_;
+    }
+}
 
-    for (auto & documents : ProcessQueries(search_server, queries))
+bool QueryResultStream::Advance()
+{
+    ++position_;
+    // запросы без результатов пропускаются
+    while (position_ >= current_.size())
     {
-        for (auto & document : documents)
+        Launch();
+        if (pending_.empty())
         {
-            doc_to_return.push_back(std::move(document));
+            return false;
         }
+        current_ = pending_.front().get();
+        pending_.pop_front();
+        position_ = 0;
     }
-    return doc_to_return;
+    return true;
+}
+
+QueryResultStream::Iterator QueryResultStream::begin()
+{
+    if (!is_started_)
+    {
+        is_started_ = true;
+        // position_ == current_.size(): первый Advance загрузит первый непустой результат
+        position_ = static_cast<size_t>(-1);
+        if (!Advance())
+        {
+            return end();
+        }
+    }
+    return Iterator(AtEnd() ? nullptr : this);
+}
+
+QueryResultStream::Iterator QueryResultStream::end()
+{
+    return Iterator(nullptr);
+}
+
+bool QueryResultStream::AtEnd() const
+{
+    return position_ >= current_.size() && pending_.empty() && next_query_ == queries_.size();
+}
+
+QueryResultStream ProcessQueriesStream(const SearchServer& search_server, const std::vector<std::string>& queries)
+{
+    return QueryResultStream(search_server, queries);
 }
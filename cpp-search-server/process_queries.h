@@ -1,9 +1,69 @@
 #pragma once
 #include <functional>
 #include <execution>
+#include <deque>
+#include <future>
+#include <iterator>
+#include <thread>
 #include <vector>
-#include <list>
 
 #include "search_server.h"
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
-std::list<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
+// Результаты всех запросов подряд в одном буфере; место каждого запроса определяется префиксной суммой числа результатов.
+// Раньше функция возвращала std::list<Document>; вектор даёт одно выделение памяти на весь пакет. Кому нужен список,
+// строит его из результата: std::list<Document>(joined.begin(), joined.end()).
+std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
+
+// Ленивый диапазон результатов пакета: документы выдаются в порядке запросов, как в ProcessQueriesJoined,
+// но каждый запрос становится доступен сразу после своего завершения. Вперёд в фоне считается
+// не больше prefetch запросов. Сервер и запросы должны жить дольше диапазона; проход однократный.
+class QueryResultStream
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        explicit Iterator(QueryResultStream* stream = nullptr);
+
+        reference operator*() const;
+        pointer operator->() const;
+        Iterator& operator++();
+        bool operator==(const Iterator& other) const;
+        bool operator!=(const Iterator& other) const;
+
+    private:
+        QueryResultStream* stream_;
+    };
+
+    QueryResultStream(const SearchServer& search_server, const std::vector<std::string>& queries,
+                      size_t prefetch = std::max(1u, std::thread::hardware_concurrency()));
+
+    QueryResultStream(const QueryResultStream&) = delete;
+    QueryResultStream& operator=(const QueryResultStream&) = delete;
+
+    Iterator begin();
+    Iterator end();
+
+private:
+    const SearchServer& search_server_;
+    const std::vector<std::string>& queries_;
+    size_t prefetch_;
+    size_t next_query_ = 0;
+    std::deque<std::future<std::vector<Document>>> pending_;
+    std::vector<Document> current_;
+    size_t position_ = 0;
+    bool is_started_ = false;
+
+    void Launch();
+    // переходит к следующему документу; false, если результаты кончились
+    bool Advance();
+    bool AtEnd() const;
+};
+
+QueryResultStream ProcessQueriesStream(const SearchServer& search_server, const std::vector<std::string>& queries);
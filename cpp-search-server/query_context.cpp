@@ -0,0 +1,42 @@
+#include "query_context.h"
+
+#include <memory>
+
+namespace
+{
+// контексты потока по глубине вложенности; живут до конца потока, чтобы их буферы переиспользовались
+thread_local std::vector<std::unique_ptr<QueryContext>> thread_contexts;
+thread_local size_t thread_context_depth = 0;
+
+QueryContext& AcquireThreadContext()
+{
+    if (thread_context_depth == thread_contexts.size())
+    {
+        thread_contexts.push_back(std::make_unique<QueryContext>());
+    }
+    return *thread_contexts[thread_context_depth++];
+}
+}
+
+size_t QueryContext::GetMemoryUsage() const
+{
+    return words_.capacity() * sizeof(std::string_view)
+        + (query_.plus_words.capacity() + query_.minus_words.capacity()) * sizeof(std::string_view)
+        + excluded_slots_.GetMemoryUsage()
+        + relevances_.capacity() * sizeof(double)
+        + is_matched_.capacity() * sizeof(uint8_t)
+        + matched_slots_.capacity() * sizeof(int)
+        + (documents_.capacity() + top_buffer_.capacity()) * sizeof(Document);
+}
+
+ThreadQueryContext::ThreadQueryContext()
+    : context_(AcquireThreadContext()){}
+
+ThreadQueryContext::~ThreadQueryContext()
+{
+    if (context_.GetMemoryUsage() > MAX_RETAINED_BYTES)
+    {
+        context_ = QueryContext{};
+    }
+    --thread_context_depth;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "document.h"
+#include "search_query.h"
+#include "slot_bitmap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Буферы одного поиска: слова и разобранный запрос, плотные накопители релевантности, исключённые слоты,
+// найденные документы и куча top_k. Между запросами буферы только очищаются, поэтому, когда их ёмкость
+// дорастёт до размера индекса и запросов, поиск через контекст перестаёт выделять память.
+// Контекст не потокобезопасен: каждому потоку нужен свой.
+class QueryContext
+{
+public:
+    // память, которую буферы удерживают между запросами, в байтах
+    size_t GetMemoryUsage() const;
+
+private:
+    friend class SearchServer;
+
+    std::vector<std::string_view> words_;
+    SearchQuery query_;
+    SlotBitmap excluded_slots_;
+    std::vector<double> relevances_;
+    std::vector<uint8_t> is_matched_;
+    std::vector<int> matched_slots_;
+    std::vector<Document> documents_;
+    std::vector<Document> top_buffer_;
+};
+
+// Контекст текущего потока для поиска без явного контекста, занятый на время жизни объекта.
+// У каждого уровня вложенности свой контекст, поэтому поиск из предиката другого поиска не портит его буферы.
+// Контексты живут до конца потока и удерживают память самого большого запроса; контекст, удерживающий
+// больше MAX_RETAINED_BYTES, при освобождении заменяется пустым, чтобы редкий огромный поиск не держал её навсегда.
+class ThreadQueryContext
+{
+public:
+    static constexpr size_t MAX_RETAINED_BYTES = size_t{64} << 20;
+
+    ThreadQueryContext();
+    ~ThreadQueryContext();
+
+    ThreadQueryContext(const ThreadQueryContext&) = delete;
+    ThreadQueryContext& operator=(const ThreadQueryContext&) = delete;
+
+    QueryContext& Get()
+    {
+        return context_;
+    }
+
+private:
+    QueryContext& context_;
+};
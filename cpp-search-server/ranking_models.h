@@ -0,0 +1,50 @@
+#pragma once
+#include "scoring_kernels.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Длины документов индекса по слотам: из них модель ранжирования строит вклад терма.
+struct DocumentLengths
+{
+    const double* inv_word_counts;
+    const uint32_t* word_counts;
+    double average_word_count;
+};
+
+// Модели ранжирования - параметр шаблона FindTopDocuments<RankingModel>. Модель считает IDF терма и один раз
+// на каждое плюс-слово запроса готовит параметры вклада, по которым AccumulateTermScores складывает вклады вхождений,
+// поэтому в цикле по вхождениям не остаётся ни логарифмов, ни ветвлений по модели.
+
+// Модель по умолчанию: доля слова в документе * log(N / df).
+struct TfIdfRanking
+{
+    static double ComputeInverseDocumentFreq(size_t document_count, size_t document_freq)
+    {
+        return std::log(document_count * 1.0 / document_freq);
+    }
+
+    static TfIdfTermScore MakeTermScore(double inverse_document_freq, const DocumentLengths& document_lengths)
+    {
+        return { document_lengths.inv_word_counts, inverse_document_freq };
+    }
+};
+
+// Okapi BM25: вклад насыщается с ростом числа вхождений (K1) и нормируется по длине документа относительно средней (B).
+struct Bm25Ranking
+{
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+    // вариант Lucene: IDF положителен и для слов, которые есть больше чем в половине документов
+    static double ComputeInverseDocumentFreq(size_t document_count, size_t document_freq)
+    {
+        return std::log(1.0 + (document_count - document_freq + 0.5) / (document_freq + 0.5));
+    }
+
+    static Bm25TermScore MakeTermScore(double inverse_document_freq, const DocumentLengths& document_lengths)
+    {
+        return { document_lengths.word_counts, inverse_document_freq * (K1 + 1.0), K1 * (1.0 - B), K1 * B / document_lengths.average_word_count };
+    }
+};
@@ -1,30 +1,75 @@
 #include "request_queue.h"
 
-RequestQueue::RequestQueue(const SearchServer &search_server)
-    : search_(search_server){}
+double ResultCacheStats::GetHitRate() const
+{
+    const size_t lookups = hits + misses;
+    return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+}
 
-std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query, [[maybe_unused]]DocumentStatus status)
+RequestQueue::RequestQueue(const SearchServer &search_server, size_t cache_capacity)
+    : search_(search_server), cache_capacity_(cache_capacity), cache_generation_(search_server.GetIndexGeneration()){}
+
+void RequestQueue::RecordRequest(const std::vector<Document>& documents)
 {
-    const auto doc = search_.FindTopDocuments(raw_query);
     if ((int)requests_.size() == min_in_day_)
     {
         requests_.pop_front();
     }
-    requests_.push_back(QueryResult({doc.size()}));
-    return doc;
+    requests_.push_back(QueryResult({documents.size()}));
 }
 
-std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query)
+std::vector<Document> RequestQueue::FindCached(const std::string& raw_query, DocumentStatus status)
 {
-    const auto doc = search_.FindTopDocuments(raw_query);
-    if ((int)requests_.size() == min_in_day_)
+    if (cache_generation_ != search_.GetIndexGeneration())
     {
-        requests_.pop_front();
+        // индекс изменился: все сохранённые результаты могли устареть
+        if (!cache_.empty())
+        {
+            ++cache_stats_.invalidations;
+        }
+        cache_index_.clear();
+        cache_.clear();
+        cache_generation_ = search_.GetIndexGeneration();
+    }
+
+    std::string key = search_.NormalizeQuery(raw_query);
+    key += static_cast<char>('0' + static_cast<int>(status));
+
+    const auto it = cache_index_.find(key);
+    if (it != cache_index_.end())
+    {
+        ++cache_stats_.hits;
+        cache_.splice(cache_.begin(), cache_, it->second);
+        return it->second->documents;
+    }
+
+    ++cache_stats_.misses;
+    std::vector<Document> documents = search_.FindTopDocuments(raw_query, status);
+    if (cache_capacity_ > 0)
+    {
+        if (cache_.size() == cache_capacity_)
+        {
+            cache_index_.erase(cache_.back().key);
+            cache_.pop_back();
+        }
+        cache_.push_front({ std::move(key), documents });
+        cache_index_.emplace(cache_.front().key, cache_.begin());
     }
-    requests_.push_back(QueryResult({doc.size()}));
+    return documents;
+}
+
+std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query, DocumentStatus status)
+{
+    const auto doc = FindCached(raw_query, status);
+    RecordRequest(doc);
     return doc;
 }
 
+std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query)
+{
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
+}
+
 int RequestQueue::GetNoResultRequests() const
 {
     int time = 0;
@@ -37,3 +82,8 @@ int RequestQueue::GetNoResultRequests() const
     }
     return time;
 }
+
+const ResultCacheStats& RequestQueue::GetCacheStats() const
+{
+    return cache_stats_;
+}
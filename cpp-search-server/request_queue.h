@@ -2,8 +2,21 @@
 #include "document.h"
 #include "search_server.h"
 #include <deque>
-#include <vector>
+#include <list>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+// Счётчики кэша результатов. Запросы с предикатом кэш не использует и считаются в bypassed.
+struct ResultCacheStats
+{
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t bypassed = 0;
+    size_t invalidations = 0;
+
+    double GetHitRate() const;
+};
 
 class RequestQueue
 {
@@ -12,27 +25,47 @@ private:
     {
         size_t requests_count = 0;
     };
+
+    struct CacheEntry
+    {
+        std::string key;
+        std::vector<Document> documents;
+    };
+
     std::deque<QueryResult> requests_;
     const static int min_in_day_ = 1440;
     const SearchServer & search_;
+
+    // LRU: в начале списка - последний использованный результат
+    size_t cache_capacity_;
+    std::list<CacheEntry> cache_;
+    std::unordered_map<std::string_view, std::list<CacheEntry>::iterator> cache_index_;
+    uint64_t cache_generation_;
+    ResultCacheStats cache_stats_;
+
+    void RecordRequest(const std::vector<Document>& documents);
+    std::vector<Document> FindCached(const std::string& raw_query, DocumentStatus status);
+
 public:
-    explicit RequestQueue(const SearchServer& search_server);
+    constexpr static size_t default_cache_capacity = 1024;
+
+    explicit RequestQueue(const SearchServer& search_server, size_t cache_capacity = default_cache_capacity);
 
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string& raw_query);
     int GetNoResultRequests() const;
+
+    const ResultCacheStats& GetCacheStats() const;
 };
 
 template <typename DocumentPredicate>
 std::vector<Document>  RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate)
 {
+    // у произвольного предиката нет идентичности, по которой можно было бы найти результат в кэше
     std::vector<Document> doc = search_.FindTopDocuments(raw_query, document_predicate);
-    if ((int)requests_.size() == min_in_day_)
-    {
-        requests_.pop_front();
-    }
-    requests_.push_back(QueryResult({doc.size()}));
+    ++cache_stats_.bypassed;
+    RecordRequest(doc);
     return doc;
     }
@@ -0,0 +1,118 @@
+#include "scoring_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCORING_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+
+namespace
+{
+const size_t SLOTS_PER_WORD = 64;
+
+// mask - биты слотов [first_slot, first_slot + 64), которые попадают в выдачу
+inline void EmitSlots(int first_slot, uint64_t mask, std::vector<int>& matched_slots)
+{
+    while (mask != 0)
+    {
+        matched_slots.push_back(first_slot + __builtin_ctzll(mask));
+        mask &= mask - 1;
+    }
+}
+
+void CollectScalar(const uint8_t* is_matched, size_t first, size_t slot_count, const SlotBitmap& excluded_slots, std::vector<int>& matched_slots)
+{
+    for (; first < slot_count; first += SLOTS_PER_WORD)
+    {
+        const size_t last = std::min(first + SLOTS_PER_WORD, slot_count);
+        uint64_t matched = 0;
+        for (size_t slot = first; slot < last; ++slot)
+        {
+            matched |= static_cast<uint64_t>(is_matched[slot] != 0) << (slot - first);
+        }
+        EmitSlots(static_cast<int>(first), matched & ~excluded_slots.GetWord(first / SLOTS_PER_WORD), matched_slots);
+    }
+}
+
+#ifdef SCORING_X86_SIMD
+__attribute__((target("avx2")))
+void CollectAvx2(const uint8_t* is_matched, size_t slot_count, const SlotBitmap& excluded_slots, std::vector<int>& matched_slots)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    size_t first = 0;
+    for (; first + SLOTS_PER_WORD <= slot_count; first += SLOTS_PER_WORD)
+    {
+        const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(is_matched + first));
+        const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(is_matched + first + 32));
+        const uint64_t unmatched = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, zero)))
+            | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, zero)))) << 32;
+        EmitSlots(static_cast<int>(first), ~unmatched & ~excluded_slots.GetWord(first / SLOTS_PER_WORD), matched_slots);
+    }
+    CollectScalar(is_matched, first, slot_count, excluded_slots, matched_slots);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void CollectAvx512(const uint8_t* is_matched, size_t slot_count, const SlotBitmap& excluded_slots, std::vector<int>& matched_slots)
+{
+    size_t first = 0;
+    for (; first + SLOTS_PER_WORD <= slot_count; first += SLOTS_PER_WORD)
+    {
+        const __m512i flags = _mm512_loadu_si512(is_matched + first);
+        const uint64_t matched = _mm512_test_epi8_mask(flags, flags);
+        EmitSlots(static_cast<int>(first), matched & ~excluded_slots.GetWord(first / SLOTS_PER_WORD), matched_slots);
+    }
+    CollectScalar(is_matched, first, slot_count, excluded_slots, matched_slots);
+}
+#endif
+
+ScoringKernel DetectScoringKernel()
+{
+#ifdef SCORING_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+    {
+        return ScoringKernel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return ScoringKernel::AVX2;
+    }
+#endif
+    return ScoringKernel::SCALAR;
+}
+}
+
+ScoringKernel GetBestScoringKernel()
+{
+    static const ScoringKernel kernel = DetectScoringKernel();
+    return kernel;
+}
+
+bool IsScoringKernelSupported(ScoringKernel kernel)
+{
+    return kernel <= GetBestScoringKernel();
+}
+
+void CollectMatchedSlots(ScoringKernel kernel, const uint8_t* is_matched, size_t slot_count, const SlotBitmap& excluded_slots,
+                         std::vector<int>& matched_slots)
+{
+    if (!IsScoringKernelSupported(kernel))
+    {
+        kernel = GetBestScoringKernel();
+    }
+    switch (kernel)
+    {
+#ifdef SCORING_X86_SIMD
+    case ScoringKernel::AVX512:
+        CollectAvx512(is_matched, slot_count, excluded_slots, matched_slots);
+        break;
+    case ScoringKernel::AVX2:
+        CollectAvx2(is_matched, slot_count, excluded_slots, matched_slots);
+        break;
+#endif
+    default:
+        CollectScalar(is_matched, 0, slot_count, excluded_slots, matched_slots);
+        break;
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "slot_bitmap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Набор инструкций, которым собираются совпавшие слоты плотных накопителей.
+enum class ScoringKernel
+{
+    SCALAR,
+    AVX2,
+    AVX512,
+};
+
+// Лучший набор, поддерживаемый процессором; определяется один раз при первом вызове.
+ScoringKernel GetBestScoringKernel();
+bool IsScoringKernelSupported(ScoringKernel kernel);
+
+// Вклад вхождений терма по TF-IDF: count * inv_word_counts[slot] * inverse_document_freq.
+struct TfIdfTermScore
+{
+    const double* inv_word_counts;
+    double inverse_document_freq;
+
+    double operator()(uint32_t count, int slot) const
+    {
+        return count * inv_word_counts[slot] * inverse_document_freq;
+    }
+};
+
+// Вклад по BM25: count * term_weight / (count + length_base + length_scale * document_lengths[slot]),
+// где term_weight = IDF * (k1 + 1), length_base = k1 * (1 - b), length_scale = k1 * b / средняя длина документа.
+struct Bm25TermScore
+{
+    const uint32_t* document_lengths;
+    double term_weight;
+    double length_base;
+    double length_scale;
+
+    double operator()(uint32_t count, int slot) const
+    {
+        return count * term_weight / (count + (length_base + length_scale * document_lengths[slot]));
+    }
+};
+
+// Добавляет вклад блока вхождений терма в плотные накопители: relevances[slots[i]] += term_score(counts[i], slots[i]),
+// is_matched[slots[i]] = 1. Исключённые слоты пропускаются, их накопители не читаются и не пишутся.
+// Сложение вразброс через gather/scatter (AVX2, AVX-512) на замерах оказалось медленнее этого цикла, поэтому набор инструкций
+// выбирается только при сборе.
+template <typename TermScore>
+void AccumulateTermScores(const int* slots, const uint32_t* counts, size_t size, const SlotBitmap& excluded_slots, const TermScore& term_score,
+                          double* relevances, uint8_t* is_matched)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        const int slot = slots[i];
+        if (!excluded_slots.Test(slot))
+        {
+            relevances[slot] += term_score(counts[i], slot);
+            is_matched[slot] = 1;
+        }
+    }
+}
+
+// Дописывает в matched_slots по возрастанию слоты из [0, slot_count), у которых is_matched ненулевой
+// и которых нет в excluded_slots.
+void CollectMatchedSlots(ScoringKernel kernel, const uint8_t* is_matched, size_t slot_count, const SlotBitmap& excluded_slots,
+                         std::vector<int>& matched_slots);
@@ -0,0 +1,81 @@
+#include "search_query.h"
+#include "string_processing.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using std::string_literals::operator""s;
+
+namespace
+{
+struct QueryWord
+{
+    std::string_view data;
+    bool is_minus;
+};
+
+QueryWord ParseQueryWord(std::string_view text)
+{
+    if (text.empty())
+    {
+        throw std::invalid_argument("Query word is empty"s);
+    }
+
+    std::string_view word = text;
+    bool is_minus = false;
+
+    if (word[0] == '-')
+    {
+        is_minus = true;
+        word = word.substr(1);
+    }
+
+    if (word.empty() || word[0] == '-')
+    {
+        throw std::invalid_argument("Query word "s + std::string(text) + " is invalid"s);
+    }
+    return { word, is_minus };
+}
+}
+
+SearchQuery ParseSearchQuery(std::string_view text, const FrozenStringSet& stop_words, bool remove_duplicates)
+{
+    std::vector<std::string_view> words;
+    SearchQuery result;
+    ParseSearchQuery(text, stop_words, remove_duplicates, words, result);
+    return result;
+}
+
+void ParseSearchQuery(std::string_view text, const FrozenStringSet& stop_words, bool remove_duplicates,
+                      std::vector<std::string_view>& words, SearchQuery& query)
+{
+    const std::string_view invalid_word = SplitIntoValidWords(text, words);
+    if (!invalid_word.empty())
+    {
+        throw std::invalid_argument("Query word "s + std::string(invalid_word) + " is invalid"s);
+    }
+    if (remove_duplicates)
+    {
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+    }
+
+    query.plus_words.clear();
+    query.minus_words.clear();
+    for (const std::string_view word : words)
+    {
+        const QueryWord query_word = ParseQueryWord(word);
+        if (!stop_words.Contains(query_word.data))
+        {
+            if (query_word.is_minus)
+            {
+                query.minus_words.push_back(query_word.data);
+            }
+            else
+            {
+                query.plus_words.push_back(query_word.data);
+            }
+        }
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "frozen_string_set.h"
+
+#include <string_view>
+#include <vector>
+
+// Разобранный запрос: плюс- и минус-слова без стоп-слов.
+struct SearchQuery
+{
+    std::vector<std::string_view> plus_words;
+    std::vector<std::string_view> minus_words;
+};
+
+// Разбирает запрос, бросает std::invalid_argument для некорректных слов.
+// При remove_duplicates слова упорядочиваются и повторы удаляются.
+SearchQuery ParseSearchQuery(std::string_view text, const FrozenStringSet& stop_words, bool remove_duplicates);
+// То же в буферы вызывающего: слова текста пишутся в words, результат - в query. Оба очищаются, их ёмкость
+// переиспользуется, поэтому повторный разбор не выделяет память.
+void ParseSearchQuery(std::string_view text, const FrozenStringSet& stop_words, bool remove_duplicates,
+                      std::vector<std::string_view>& words, SearchQuery& query);
@@ -1,4 +1,8 @@
 #include "search_server.h"
+#include "index_snapshot.h"
+
+#include <cstring>
+#include <fstream>
 
 using std::string_literals::operator""s;
 
@@ -12,7 +16,7 @@ SearchServer::SearchServer(const std::string& stopWords)
 
 bool SearchServer::IsStopWord(const std::string_view& word) const
 {
-    return stop_words_.count(static_cast<std::string>(word)) > 0;
+    return stop_words_.Contains(word);
 }
 
 bool SearchServer::IsValidWord(const std::string_view& word) const
@@ -23,22 +27,18 @@ bool SearchServer::IsValidWord(const std::string_view& word) const
     });
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view& text) const
+void SearchServer::SplitIntoWordsNoStop(const std::string_view& text, std::vector<std::string_view>& words) const
 {
-    std::vector<std::string_view> words;
-    for (const std::string_view& word : SplitIntoWords(text))
+    const std::string_view invalid_word = SplitIntoValidWords(text, words);
+    if (!invalid_word.empty())
     {
-        if (!IsValidWord(word))
-        {
-            throw std::invalid_argument("Word "s + std::string(word) + " is invalid"s);
-        }
-
-        if (!IsStopWord(word))
-        {
-            words.push_back(word);
-        }
+        throw std::invalid_argument("Word "s + std::string(invalid_word) + " is invalid"s);
     }
-    return words;
+
+    words.erase(std::remove_if(words.begin(), words.end(), [this](std::string_view word)
+    {
+        return IsStopWord(word);
+    }), words.end());
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings)
@@ -53,27 +53,95 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings)
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view& text) const
+int SearchServer::AllocateSlot(int document_id, DocumentStatus status, int rating, uint32_t word_count)
+{
+    const double inv_word_count = 1.0 / word_count;
+    int slot;
+    if (!free_slots_.empty())
+    {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+        slot_document_ids_[slot] = document_id;
+        slot_statuses_[slot] = status;
+        slot_ratings_[slot] = rating;
+        slot_inv_word_counts_[slot] = inv_word_count;
+        slot_word_counts_[slot] = word_count;
+    }
+    else
+    {
+        slot = static_cast<int>(slot_document_ids_.size());
+        slot_document_ids_.push_back(document_id);
+        slot_statuses_.push_back(status);
+        slot_ratings_.push_back(rating);
+        slot_inv_word_counts_.push_back(inv_word_count);
+        slot_word_counts_.push_back(word_count);
+        slot_terms_.emplace_back();
+        for (SlotBitmap& slots : status_slots_)
+        {
+            slots.Resize(slot_document_ids_.size());
+        }
+    }
+    status_slots_[static_cast<size_t>(status)].Set(slot);
+    total_word_count_ += word_count;
+    document_slots_.emplace(document_id, slot);
+    return slot;
+}
+
+int SearchServer::FindSlot(int document_id) const
+{
+    const auto it = document_slots_.find(document_id);
+    return it == document_slots_.end() ? -1 : it->second;
+}
+
+void SearchServer::CheckNewDocumentId(int document_id) const
 {
-    if (text.empty())
+    if (document_id < 0)
+    {
+        throw std::invalid_argument( "Document id "s + std::to_string(document_id) + " is invalid (is negative)" );
+    }
+    if (document_slots_.count(document_id) > 0)
     {
-        throw std::invalid_argument("Query word is empty"s);
+       throw std::invalid_argument( "Document with such ID"s + std::to_string(document_id)  + "already exists" );
     }
+}
 
-    std::string_view word = text;
-    bool is_minus = false;
+SearchServer::DocumentWords SearchServer::ParseDocument(const std::string_view& document, std::vector<std::string_view>& words) const
+{
+    SplitIntoWordsNoStop(document, words);
 
-    if (word[0] == '-')
+    // одинаковые слова после сортировки идут подряд: число вхождений - длина серии
+    std::sort(words.begin(), words.end());
+    size_t distinct_count = 0;
+    for (size_t i = 0; i < words.size(); ++i)
     {
-        is_minus = true;
-        word = word.substr(1);
+        distinct_count += (i == 0 || words[i] != words[i - 1]) ? 1 : 0;
     }
 
-    if (word.empty() || word[0] == '-' || !IsValidWord(word))
+    DocumentWords result;
+    result.word_count = words.size();
+    result.word_counts.reserve(distinct_count);
+    for (auto it = words.begin(); it != words.end();)
     {
-        throw std::invalid_argument("Query word "s + std::string(text) + " is invalid"s);
+        const auto run_end = std::find_if(it, words.end(), [&it](std::string_view word)
+        {
+            return word != *it;
+        });
+        result.word_counts.emplace_back(*it, static_cast<uint32_t>(run_end - it));
+        it = run_end;
     }
-    return { word, is_minus, IsStopWord(word) };
+    return result;
+}
+
+int SearchServer::InternTerm(const std::string_view& word)
+{
+    const int term_id = terms_.Intern(word);
+    if (static_cast<size_t>(term_id) == postings_.size())
+    {
+        postings_.emplace_back(posting_codec_);
+        impact_postings_.emplace_back();
+        term_idfs_.emplace_back();
+    }
+    return term_id;
 }
 
 SearchServer::Query SearchServer::ParseQuery(const std::string_view& text) const
@@ -81,9 +149,105 @@ SearchServer::Query SearchServer::ParseQuery(const std::string_view& text) const
     return ParseQuery(std::execution::seq, text);
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view& word) const
+void SearchServer::ParseQuery(const std::string_view& text, QueryContext& context) const
+{
+    ParseSearchQuery(text, stop_words_, true, context.words_, context.query_);
+}
+
+void SearchServer::AddPosting(int term_id, int slot, uint32_t count)
+{
+    const double term_freq = ComputeTermFreq(count, slot);
+    postings_[term_id].Add(slot, count, term_freq);
+    if (is_impact_ordered_)
+    {
+        impact_postings_[term_id].Add(slot, count, term_freq);
+    }
+}
+
+void SearchServer::RemovePosting(const TermOccurrence& occurrence, int slot)
+{
+    postings_[occurrence.term_id].Remove(slot);
+    if (is_impact_ordered_)
+    {
+        impact_postings_[occurrence.term_id].Remove(slot, ComputeTermFreq(occurrence.count, slot));
+    }
+}
+
+uint32_t SearchServer::FindTermCount(int slot, int term_id) const
+{
+    // прямой индекс документа упорядочен по словам
+    const std::vector<TermOccurrence>& occurrences = slot_terms_[slot];
+    const std::string_view word = terms_.GetTerm(term_id);
+    const auto it = std::lower_bound(occurrences.begin(), occurrences.end(), word, [this](const TermOccurrence& occurrence, std::string_view word)
+    {
+        return terms_.GetTerm(occurrence.term_id) < word;
+    });
+    return it != occurrences.end() && it->term_id == term_id ? it->count : 0;
+}
+
+void SearchServer::ExcludeMinusWordSlots(const Query& query, SlotBitmap& excluded_slots) const
+{
+    for (const std::string_view& word : query.minus_words)
+    {
+        const PostingList* postings = FindPostingList(word);
+        if (postings == nullptr)
+        {
+            continue;
+        }
+        postings->ForEachBlock([&excluded_slots](const PostingList::Block& block)
+        {
+            for (size_t i = 0; i < block.size; ++i)
+            {
+                excluded_slots.Set(block.slots[i]);
+            }
+        });
+    }
+}
+
+void SearchServer::ExcludeRejectedSlots(StatusIs predicate, SlotBitmap& excluded_slots) const
+{
+    excluded_slots.UniteWithComplement(status_slots_[static_cast<size_t>(predicate.status)]);
+}
+
+const PostingList* SearchServer::FindPostingList(const std::string_view& word) const
+{
+    const int term_id = terms_.Find(word);
+    if (term_id == TermDictionary::NO_TERM)
+    {
+        return nullptr;
+    }
+    return &postings_[term_id];
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(const PostingList& postings) const
+{
+    // списки вхождений лежат в postings_ по номерам термов
+    CachedInverseDocumentFreq& cached = term_idfs_[&postings - postings_.data()];
+    if (cached.epoch.load(std::memory_order_acquire) == generation_)
+    {
+        return cached.value.load(std::memory_order_relaxed);
+    }
+    const double inverse_document_freq = TfIdfRanking::ComputeInverseDocumentFreq(GetDocumentCount(), postings.size());
+    cached.value.store(inverse_document_freq, std::memory_order_relaxed);
+    cached.epoch.store(generation_, std::memory_order_release);
+    return inverse_document_freq;
+}
+
+DocumentLengths SearchServer::GetDocumentLengths() const
 {
-    return std::log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+    const size_t document_count = GetDocumentCount();
+    return { slot_inv_word_counts_.data(), slot_word_counts_.data(), document_count == 0 ? 0.0 : total_word_count_ * 1.0 / document_count };
+}
+
+void SearchServer::RefreshInverseDocumentFreqs()
+{
+    for (const PostingList& postings : postings_)
+    {
+        if (!postings.empty())
+        {
+            ComputeWordInverseDocumentFreq(postings);
+        }
+    }
 }
 
 void SearchServer::SortAndRemoveDublicates(std::vector<std::string_view>& dummy) const
@@ -98,56 +262,174 @@ void SearchServer::SortAndRemoveDublicates(std::vector<std::string_view>& dummy)
     }
 }
 
-const std::map<std::string, double>& SearchServer::GetWordFrequencies(int document_id) const
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const
 {
-    const auto it_to_doc = freqs_by_id_.find(document_id);
-
-    const static std::map<std::string, double> tmp;
-
-    if (it_to_doc == freqs_by_id_.end())
+    const int slot = FindSlot(document_id);
+    if (slot < 0)
     {
-        return tmp;
+        return {};
     }
-    return it_to_doc->second;
+    return { terms_, slot_terms_[slot], slot_inv_word_counts_[slot] };
 }
 //--------------------public methods------------------//
 void SearchServer::AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings)
 {
-    //std::string error = ""s;
-    using namespace std::literals::string_literals;
-    if (document_id < 0)
+    CheckNewDocumentId(document_id);
+
+    const DocumentWords words = ParseDocument(document, word_buffer_);
+    const int slot = AllocateSlot(document_id, status, ComputeAverageRating(ratings), static_cast<uint32_t>(words.word_count));
+
+    std::vector<TermOccurrence>& occurrences = slot_terms_[slot];
+    occurrences.reserve(words.word_counts.size());
+    for (const auto& [word, count] : words.word_counts)
     {
-        throw std::invalid_argument( "Document id "s + std::to_string(document_id) + " is invalid (is negative)" );
+        const int term_id = InternTerm(word);
+        AddPosting(term_id, slot, count);
+        occurrences.push_back({ term_id, count });
     }
-    if (documents_.count(document_id) > 0)
+    document_ids_.insert(document_id);
+    ++generation_;
+}
+
+void SearchServer::AddDocumentBatch(const std::vector<BatchDocument>& batch, size_t shard_count)
+{
+    std::set<int> batch_ids;
+    for (const BatchDocument& document : batch)
     {
-       throw std::invalid_argument( "Document with such ID"s + std::to_string(document_id)  + "already exists" );
+        CheckNewDocumentId(document.id);
+        if (!batch_ids.insert(document.id).second)
+        {
+            throw std::invalid_argument( "Document with such ID"s + std::to_string(document.id)  + "already exists" );
+        }
     }
-//    if (error != ""s)
-//    {
-//        throw std::invalid_argument(error);
-//    }
 
-    const auto words = SplitIntoWordsNoStop(document);
-    std::vector<std::string> words_(words.begin(), words.end());
-    const double inv_word_count = 1.0 / words.size();
+    // Пакет делится на непрерывные куски. Каждый кусок разбирается в своём потоке в частичный индекс
+    // с локальными номерами термов в порядке первого появления.
+    struct Shard
+    {
+        size_t first;
+        size_t last;
+        std::vector<std::string_view> terms;
+        std::vector<int> global_term_ids;
+        // локальный терм -> (номер документа в пакете, число вхождений)
+        std::vector<std::vector<std::pair<size_t, uint32_t>>> postings;
+        std::vector<std::vector<TermOccurrence>> occurrences;
+        std::vector<size_t> word_counts;
+    };
 
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status, words_ });
+    shard_count = std::max<size_t>(1, std::min(shard_count, batch.size() / min_documents_per_shard_));
+    std::vector<Shard> shards(shard_count);
+    for (size_t i = 0; i < shard_count; ++i)
+    {
+        shards[i].first = batch.size() * i / shard_count;
+        shards[i].last = batch.size() * (i + 1) / shard_count;
+    }
+
+    const auto build_shard = [this, &batch](Shard& shard)
+    {
+        std::unordered_map<std::string_view, int> local_ids;
+        std::vector<std::string_view> word_buffer;
+        for (size_t index = shard.first; index < shard.last; ++index)
+        {
+            const DocumentWords words = ParseDocument(batch[index].text, word_buffer);
+            std::vector<TermOccurrence>& occurrences = shard.occurrences.emplace_back();
+            occurrences.reserve(words.word_counts.size());
+            for (const auto& [word, count] : words.word_counts)
+            {
+                const auto [it, inserted] = local_ids.emplace(word, static_cast<int>(shard.terms.size()));
+                if (inserted)
+                {
+                    shard.terms.push_back(word);
+                    shard.postings.emplace_back();
+                }
+                shard.postings[it->second].emplace_back(index, count);
+                occurrences.push_back({ it->second, count });
+            }
+            shard.word_counts.push_back(words.word_count);
+        }
+    };
 
-    for (const std::string& word : documents_.at(document_id).words_list)
+    std::vector<std::future<void>> shard_builds;
+    for (size_t i = 1; i < shard_count; ++i)
     {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        freqs_by_id_[document_id][word] += inv_word_count;
+        shard_builds.push_back(std::async(std::launch::async, build_shard, std::ref(shards[i])));
+    }
+    build_shard(shards[0]);
+    // ошибка разбора любого документа пробрасывается до изменения индекса
+    for (auto& shard_build : shard_builds)
+    {
+        shard_build.get();
+    }
+
+    // Слоты и номера термов раздаются последовательно в порядке пакета, как при поочерёдных вызовах AddDocument.
+    std::vector<int> slots(batch.size());
+    for (const Shard& shard : shards)
+    {
+        for (size_t index = shard.first; index < shard.last; ++index)
+        {
+            const BatchDocument& document = batch[index];
+            slots[index] = AllocateSlot(document.id, document.status, ComputeAverageRating(*document.ratings),
+                                        static_cast<uint32_t>(shard.word_counts[index - shard.first]));
+            document_ids_.insert(document.id);
+        }
+    }
+    for (Shard& shard : shards)
+    {
+        shard.global_term_ids.reserve(shard.terms.size());
+        for (const std::string_view& word : shard.terms)
+        {
+            shard.global_term_ids.push_back(InternTerm(word));
+        }
+    }
+
+    // Слияние: поток i дописывает вхождения термов с номером, равным i по модулю числа потоков, проходя куски по порядку,
+    // поэтому каждый список вхождений получает те же Add в том же порядке, что и при последовательной загрузке.
+    // Заодно поток i переводит прямой индекс куска i на глобальные номера термов.
+    const auto merge_shards = [this, &shards, &slots, shard_count](size_t part)
+    {
+        for (const Shard& shard : shards)
+        {
+            for (size_t local_id = 0; local_id < shard.terms.size(); ++local_id)
+            {
+                const int term_id = shard.global_term_ids[local_id];
+                if (static_cast<size_t>(term_id) % shard_count != part)
+                {
+                    continue;
+                }
+                for (const auto& [index, count] : shard.postings[local_id])
+                {
+                    AddPosting(term_id, slots[index], count);
+                }
+            }
+        }
+
+        Shard& shard = shards[part];
+        for (size_t index = shard.first; index < shard.last; ++index)
+        {
+            std::vector<TermOccurrence>& occurrences = shard.occurrences[index - shard.first];
+            for (TermOccurrence& occurrence : occurrences)
+            {
+                occurrence.term_id = shard.global_term_ids[occurrence.term_id];
+            }
+            slot_terms_[slots[index]] = std::move(occurrences);
+        }
+    };
+
+    std::vector<std::future<void>> merges;
+    for (size_t part = 1; part < shard_count; ++part)
+    {
+        merges.push_back(std::async(std::launch::async, merge_shards, part));
+    }
+    merge_shards(0);
+    for (auto& merge : merges)
+    {
+        merge.get();
     }
-    document_ids_.insert(document_id);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t top_k) const
 {
-    return FindTopDocuments(raw_query, [status]([[__maybe_unused__]]int document_id, DocumentStatus document_status, int rating)
-    {
-        return document_status == status;
-    });
+    return FindTopDocuments(raw_query, StatusIs{ status }, top_k);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query) const
@@ -155,9 +437,384 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, const std::string_view& raw_query, DocumentStatus status,
+                                                            size_t top_k) const
+{
+    return FindTopDocuments(context, raw_query, StatusIs{ status }, top_k);
+}
+
+std::vector<Document> SearchServer::FindTopDocumentsPruned(const std::string_view& raw_query, DocumentStatus status, size_t top_k,
+                                                           PruningStats* stats) const
+{
+    return FindTopDocumentsPruned(raw_query, StatusIs{ status }, top_k, stats);
+}
+
+std::vector<Document> SearchServer::FindTopDocumentsByImpact(const std::string_view& raw_query, DocumentStatus status, size_t top_k,
+                                                             size_t max_postings, ImpactSearchStats* stats) const
+{
+    return FindTopDocumentsByImpact(raw_query, StatusIs{ status }, top_k, max_postings, stats);
+}
+
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries, DocumentStatus status,
+                                                                       size_t top_k) const
+{
+    std::vector<Query> queries;
+    queries.reserve(raw_queries.size());
+    for (const std::string& raw_query : raw_queries)
+    {
+        queries.push_back(ParseQuery(raw_query));
+    }
+
+    std::vector<std::vector<Document>> results(queries.size());
+    const SlotBitmap& status_slots = status_slots_[static_cast<size_t>(status)];
+    const size_t slot_count = slot_document_ids_.size();
+    if (slot_count == 0)
+    {
+        return results;
+    }
+
+    struct BatchTerm
+    {
+        const PostingList* postings = nullptr;
+        double inverse_document_freq = 0.0;
+        std::vector<size_t> plus_queries;
+        std::vector<size_t> minus_queries;
+    };
+
+    // Запросы обрабатываются группами, чтобы накопители (слот x запрос) помещались в max_batch_accumulator_bytes_.
+    const size_t group_size = std::max<size_t>(1, max_batch_accumulator_bytes_ / (slot_count * (sizeof(double) + 1)));
+    for (size_t group_begin = 0; group_begin < queries.size(); group_begin += group_size)
+    {
+        const size_t group_end = std::min(group_begin + group_size, queries.size());
+        const size_t query_count = group_end - group_begin;
+
+        // Термы упорядочены так же, как плюс-слова в каждом разобранном запросе, поэтому вклады
+        // в релевантность документа складываются в том же порядке, что и в FindTopDocuments.
+        std::map<std::string_view, BatchTerm> terms;
+        for (size_t query_index = group_begin; query_index < group_end; ++query_index)
+        {
+            for (const std::string_view& word : queries[query_index].plus_words)
+            {
+                terms[word].plus_queries.push_back(query_index - group_begin);
+            }
+            for (const std::string_view& word : queries[query_index].minus_words)
+            {
+                terms[word].minus_queries.push_back(query_index - group_begin);
+            }
+        }
+        for (auto it = terms.begin(); it != terms.end();)
+        {
+            it->second.postings = FindPostingList(it->first);
+            if (it->second.postings == nullptr || it->second.postings->empty())
+            {
+                it = terms.erase(it);
+                continue;
+            }
+            it->second.inverse_document_freq = ComputeWordInverseDocumentFreq(*it->second.postings);
+            ++it;
+        }
+
+        // Слоты делятся на диапазоны; накопители диапазона хранятся по слотам, в слоте - подряд по запросам группы.
+        const size_t thread_count = std::max<size_t>(1, std::min(thread_count_, slot_count / min_slots_per_thread_));
+        const size_t range_size = (slot_count + thread_count - 1) / thread_count;
+        const auto score_range = [&, query_count](int first_slot, int last_slot)
+        {
+            const size_t range_length = last_slot - first_slot;
+            std::vector<double> document_to_relevance(range_length * query_count);
+            std::vector<char> is_matched(range_length * query_count);
+
+            for (const auto& [word, term] : terms)
+            {
+                if (term.plus_queries.empty())
+                {
+                    continue;
+                }
+                PostingList::Cursor cursor(*term.postings);
+                for (cursor.Seek(first_slot); !cursor.AtEnd() && cursor.Slot() < last_slot; cursor.Next())
+                {
+                    const int slot = cursor.Slot();
+                    if (!status_slots.Test(slot))
+                    {
+                        continue;
+                    }
+                    const double contribution = ComputeTermFreq(cursor.Count(), slot) * term.inverse_document_freq;
+                    const size_t base = (slot - first_slot) * query_count;
+                    for (const size_t query : term.plus_queries)
+                    {
+                        document_to_relevance[base + query] += contribution;
+                        is_matched[base + query] = 1;
+                    }
+                }
+            }
+
+            for (const auto& [word, term] : terms)
+            {
+                if (term.minus_queries.empty())
+                {
+                    continue;
+                }
+                PostingList::Cursor cursor(*term.postings);
+                for (cursor.Seek(first_slot); !cursor.AtEnd() && cursor.Slot() < last_slot; cursor.Next())
+                {
+                    const size_t base = (cursor.Slot() - first_slot) * query_count;
+                    for (const size_t query : term.minus_queries)
+                    {
+                        is_matched[base + query] = 0;
+                    }
+                }
+            }
+
+            std::vector<std::vector<Document>> matched_documents(query_count);
+            for (size_t offset = 0; offset < range_length; ++offset)
+            {
+                const int slot = first_slot + static_cast<int>(offset);
+                for (size_t query = 0; query < query_count; ++query)
+                {
+                    if (is_matched[offset * query_count + query])
+                    {
+                        matched_documents[query].push_back({slot_document_ids_[slot], document_to_relevance[offset * query_count + query], slot_ratings_[slot]});
+                    }
+                }
+            }
+            return matched_documents;
+        };
+
+        std::vector<std::future<std::vector<std::vector<Document>>>> range_results;
+        for (size_t first = range_size; first < slot_count; first += range_size)
+        {
+            range_results.push_back(std::async(std::launch::async, score_range, static_cast<int>(first),
+                                               static_cast<int>(std::min(first + range_size, slot_count))));
+        }
+        std::vector<std::vector<Document>> group_documents = score_range(0, static_cast<int>(std::min(range_size, slot_count)));
+        // диапазоны сливаются по возрастанию слотов, как и документы в FindAllDocuments
+        for (auto& range_result : range_results)
+        {
+            std::vector<std::vector<Document>> range_documents = range_result.get();
+            for (size_t query = 0; query < query_count; ++query)
+            {
+                group_documents[query].insert(group_documents[query].end(), range_documents[query].begin(), range_documents[query].end());
+            }
+        }
+        for (size_t query = 0; query < query_count; ++query)
+        {
+            SelectTopDocuments(group_documents[query], top_k);
+            results[group_begin + query] = std::move(group_documents[query]);
+        }
+    }
+    return results;
+}
+
 size_t SearchServer::GetDocumentCount() const
 {
-    return documents_.size();
+    return document_slots_.size();
+}
+
+size_t SearchServer::GetDocumentFreq(const std::string_view& word) const
+{
+    const PostingList* postings = FindPostingList(word);
+    return postings == nullptr ? 0 : postings->size();
+}
+
+bool SearchServer::HasDocument(int document_id) const
+{
+    return FindSlot(document_id) >= 0;
+}
+
+uint64_t SearchServer::GetIndexGeneration() const
+{
+    return generation_;
+}
+
+std::string SearchServer::NormalizeQuery(const std::string_view& raw_query) const
+{
+    const Query query = ParseQuery(raw_query);
+    std::string normalized;
+    for (const std::string_view& word : query.plus_words)
+    {
+        normalized += word;
+        normalized += ' ';
+    }
+    for (const std::string_view& word : query.minus_words)
+    {
+        normalized += '-';
+        normalized += word;
+        normalized += ' ';
+    }
+    return normalized;
+}
+
+void SearchServer::SetThreadCount(size_t thread_count)
+{
+    thread_count_ = std::max<size_t>(thread_count, 1);
+}
+
+size_t SearchServer::GetThreadCount() const
+{
+    return thread_count_;
+}
+
+void SearchServer::SetPostingCodec(PostingCodec codec)
+{
+    posting_codec_ = codec;
+    for (PostingList& postings : postings_)
+    {
+        postings.SetCodec(codec);
+    }
+}
+
+PostingCodec SearchServer::GetPostingCodec() const
+{
+    return posting_codec_;
+}
+
+void SearchServer::SetImpactOrderedPostings(bool enabled)
+{
+    for (ImpactPostings& postings : impact_postings_)
+    {
+        postings.Clear();
+    }
+    is_impact_ordered_ = enabled;
+    if (!enabled)
+    {
+        return;
+    }
+    // проход по слотам по возрастанию: вхождения дописываются в конец сегментов
+    for (size_t slot = 0; slot < slot_terms_.size(); ++slot)
+    {
+        for (const TermOccurrence& occurrence : slot_terms_[slot])
+        {
+            impact_postings_[occurrence.term_id].Add(slot, occurrence.count, ComputeTermFreq(occurrence.count, slot));
+        }
+    }
+}
+
+bool SearchServer::HasImpactOrderedPostings() const
+{
+    return is_impact_ordered_;
+}
+
+size_t SearchServer::GetIndexMemoryUsage() const
+{
+    size_t memory_usage = postings_.capacity() * sizeof(PostingList) + term_idfs_.capacity() * sizeof(CachedInverseDocumentFreq);
+    for (const PostingList& postings : postings_)
+    {
+        memory_usage += postings.GetMemoryUsage() - sizeof(PostingList);
+    }
+    if (is_impact_ordered_)
+    {
+        for (const ImpactPostings& postings : impact_postings_)
+        {
+            memory_usage += postings.GetMemoryUsage();
+        }
+    }
+    return memory_usage;
+}
+
+void SearchServer::SaveSnapshot(const std::string& path) const
+{
+    std::vector<char> file(sizeof(snapshot::Header));
+
+    // секция дописывается в конец файла с выравниванием по 8 байт
+    const auto append = [&file](const auto& items)
+    {
+        using Item = typename std::decay_t<decltype(items)>::value_type;
+        file.resize((file.size() + 7) / 8 * 8);
+        const snapshot::Section section = { file.size(), items.size() };
+        const char* data = reinterpret_cast<const char*>(items.data());
+        file.insert(file.end(), data, data + items.size() * sizeof(Item));
+        return section;
+    };
+
+    std::string chars;
+    const auto add_string = [&chars](std::string_view word)
+    {
+        const snapshot::StringRef string = { chars.size(), word.size() };
+        chars += word;
+        return string;
+    };
+
+    std::vector<snapshot::StringRef> stop_words;
+    for (const std::string_view word : stop_words_.GetWords())
+    {
+        stop_words.push_back(add_string(word));
+    }
+
+    std::vector<int> term_ids;
+    for (size_t term_id = 0; term_id < postings_.size(); ++term_id)
+    {
+        if (!postings_[term_id].empty())
+        {
+            term_ids.push_back(static_cast<int>(term_id));
+        }
+    }
+    std::sort(term_ids.begin(), term_ids.end(), [this](int lhs, int rhs)
+    {
+        return terms_.GetTerm(lhs) < terms_.GetTerm(rhs);
+    });
+
+    // все вхождения сжимаются блоками не длиннее BLOCK_SIZE, включая несжатые хвосты и списки PLAIN
+    std::vector<snapshot::Term> terms;
+    std::vector<PostingList::BlockInfo> blocks;
+    std::vector<uint8_t> posting_bytes;
+    std::vector<uint8_t> term_bytes;
+    for (const int term_id : term_ids)
+    {
+        const PostingList& postings = postings_[term_id];
+        snapshot::Term term = { add_string(terms_.GetTerm(term_id)), blocks.size(), 0, posting_bytes.size(), postings.size() };
+        term_bytes.clear();
+        postings.ForEachBlock([&blocks, &term_bytes](const PostingList::Block& block)
+        {
+            for (size_t begin = 0; begin < block.size; begin += PostingList::BLOCK_SIZE)
+            {
+                const size_t size = std::min(PostingList::BLOCK_SIZE, block.size - begin);
+                blocks.push_back(PostingList::EncodeBlock(block.slots + begin, block.counts + begin, size, term_bytes));
+            }
+        });
+        term.block_count = blocks.size() - term.first_block;
+        posting_bytes.insert(posting_bytes.end(), term_bytes.begin(), term_bytes.end());
+        terms.push_back(term);
+    }
+
+    std::vector<int32_t> slot_document_ids(slot_document_ids_.begin(), slot_document_ids_.end());
+    for (const int slot : free_slots_)
+    {
+        slot_document_ids[slot] = -1;
+    }
+    std::vector<int32_t> slot_statuses;
+    for (const DocumentStatus status : slot_statuses_)
+    {
+        slot_statuses.push_back(static_cast<int32_t>(status));
+    }
+    const std::vector<int32_t> slot_ratings(slot_ratings_.begin(), slot_ratings_.end());
+    std::vector<snapshot::DocumentSlot> documents;
+    for (const auto& [document_id, slot] : document_slots_)
+    {
+        documents.push_back({ document_id, slot });
+    }
+
+    snapshot::Header header = {};
+    std::memcpy(header.magic, snapshot::MAGIC, sizeof(snapshot::MAGIC));
+    header.version = snapshot::VERSION;
+    header.byte_order_mark = snapshot::BYTE_ORDER_MARK;
+    header.document_count = GetDocumentCount();
+    header.stop_words = append(stop_words);
+    header.terms = append(terms);
+    header.blocks = append(blocks);
+    header.posting_bytes = append(posting_bytes);
+    header.chars = append(chars);
+    header.slot_document_ids = append(slot_document_ids);
+    header.slot_statuses = append(slot_statuses);
+    header.slot_ratings = append(slot_ratings);
+    header.slot_inv_word_counts = append(slot_inv_word_counts_);
+    header.documents = append(documents);
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(file.data(), static_cast<std::streamsize>(file.size()));
+    if (!out)
+    {
+        throw std::runtime_error("Cannot write snapshot "s + path);
+    }
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query, int document_id) const
@@ -165,16 +822,23 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
     const auto query = ParseQuery(raw_query);
     std::vector<std::string_view> matched_words;
 
-    if (documents_.count(document_id) == 0)
+    const int slot = FindSlot(document_id);
+    if (slot < 0)
     {
         throw std::out_of_range("Document out of range");
     }
 
     bool isMinus = false;
 
+    const auto contains_document = [this, slot](std::string_view word)
+    {
+        const PostingList* postings = FindPostingList(word);
+        return postings != nullptr && postings->Contains(slot);
+    };
+
     for (const std::string_view& word : query.minus_words)
     {
-        if (word_to_document_freqs_.count(word) > 0 && word_to_document_freqs_.at(word).count(document_id) > 0)
+        if (contains_document(word))
         {
             matched_words.clear();
             isMinus = true;
@@ -186,13 +850,13 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
     {
         for (const std::string_view& word : query.plus_words)
         {
-            if (word_to_document_freqs_.count(word) > 0 && word_to_document_freqs_.at(word).count(document_id) > 0)
+            if (contains_document(word))
             {
                 matched_words.push_back(word);
             }
         }
     }
-    return { matched_words, documents_.at(document_id).status };
+    return { matched_words, slot_statuses_[slot] };
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy, std::string_view raw_query, int document_id) const
@@ -202,20 +866,21 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::parallel_policy policy, std::string_view raw_query, int document_id) const
 {
-    if (documents_.count(document_id) == 0)
+    const int slot = FindSlot(document_id);
+    if (slot < 0)
     {
         throw std::out_of_range("Wrong document id");
     }
 
     auto query = ParseQuery(policy, raw_query);
 
-    const auto l = [this, document_id](std::string_view word)
+    const auto l = [this, slot](std::string_view word)
     {
-        const auto it = word_to_document_freqs_.find(word);
-        return it != word_to_document_freqs_.end() && it->second.count(document_id);
+        const PostingList* postings = FindPostingList(word);
+        return postings != nullptr && postings->Contains(slot);
     };
 
-    const auto& status = documents_.at(document_id).status;
+    const auto& status = slot_statuses_[slot];
 
     if (std::any_of(policy, query.minus_words.begin(), query.minus_words.end(), l))
     {
@@ -238,48 +903,50 @@ void SearchServer::RemoveDocument(int document_id)
 
 void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int document_id)
 {
+    const int slot = FindSlot(document_id);
+    if (slot < 0)
+    {
+        return;
+    }
     document_ids_.erase(document_id);
 
+    // у документа каждый терм встречается один раз, поэтому потоки меняют разные списки вхождений
+    std::vector<TermOccurrence>& occurrences = slot_terms_[slot];
+    std::for_each(std::execution::par, occurrences.begin(), occurrences.end(),
+    [this, slot](const TermOccurrence& occurrence)
     {
-        const auto& doc_to_freq = freqs_by_id_.find(document_id);
-        if (doc_to_freq != freqs_by_id_.end())
-        {
-            const auto& words_freq = doc_to_freq->second;
-            std::vector<const std::string*> words_to_remove(words_freq.size());
-
-            std::transform(std::execution::par, words_freq.begin(), words_freq.end(), words_to_remove.begin(),
-            [](const auto& word_to_freq)
-            {
-                return &word_to_freq.first;
-            });
-
-            std::for_each(std::execution::par, words_to_remove.begin(), words_to_remove.end(),
-            [this, document_id](const auto& word_to_remove)
-            {
-                this->word_to_document_freqs_.at(*word_to_remove).erase(document_id);
-            });
-
-            freqs_by_id_.erase(doc_to_freq);
-        }
-    }
+        this->RemovePosting(occurrence, slot);
+    });
+    std::vector<TermOccurrence>().swap(occurrences);
 
-    documents_.erase(document_id);
+    document_slots_.erase(document_id);
+    status_slots_[static_cast<size_t>(slot_statuses_[slot])].Reset(slot);
+    total_word_count_ -= slot_word_counts_[slot];
+    free_slots_.push_back(slot);
+    ++generation_;
 }
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy &, int document_id)
 {
-    if (document_ids_.count(document_id) == 1)
+    const int slot = FindSlot(document_id);
+    if (slot < 0)
     {
-        const auto & word_freq = GetWordFrequencies(document_id);
-        for_each(std::execution::seq, word_freq.begin(), word_freq.end(), [&document_id, this](const auto& item)
-        {
-            word_to_document_freqs_.at(item.first).erase(document_id);
-        ;});
+        return;
     }
 
+    std::vector<TermOccurrence>& occurrences = slot_terms_[slot];
+    for_each(std::execution::seq, occurrences.begin(), occurrences.end(), [slot, this](const TermOccurrence& occurrence)
+    {
+        RemovePosting(occurrence, slot);
+    ;});
+    std::vector<TermOccurrence>().swap(occurrences);
+
     document_ids_.erase(document_id);
-    documents_.erase(document_id);
-    freqs_by_id_.erase(document_id);
+    document_slots_.erase(document_id);
+    status_slots_[static_cast<size_t>(slot_statuses_[slot])].Reset(slot);
+    total_word_count_ -= slot_word_counts_[slot];
+    free_slots_.push_back(slot);
+    ++generation_;
 
     return;
 }
@@ -4,8 +4,17 @@
 #include "paginator.h"
 #include "read_input_functions.h"
 #include "string_processing.h"
-#include "concurrent_map.h"
+#include "inverted_index.h"
+#include "impact_postings.h"
+#include "frozen_string_set.h"
+#include "search_query.h"
 #include "log_duration.h"
+#include "top_documents.h"
+#include "slot_bitmap.h"
+#include "document_predicates.h"
+#include "scoring_kernels.h"
+#include "ranking_models.h"
+#include "query_context.h"
 
 #include <vector>
 #include <string>
@@ -13,62 +22,180 @@
 #include <map>
 #include <iterator>
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <iostream>
 #include <numeric>
 #include <cmath>
 #include <execution>
 #include <future>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double EPSILON = 1e-6;
+
+// Статистика динамического отсечения: сколько вхождений плюс-слов было оценено и сколько пропущено.
+struct PruningStats
+{
+    size_t postings_scored = 0;
+    size_t postings_skipped = 0;
+};
+
+const size_t NO_POSTINGS_BUDGET = std::numeric_limits<size_t>::max();
+
+// Статистика поиска по вкладу: сколько вхождений оценено из скольких и доказано ли, что результат совпадает с полным поиском.
+struct ImpactSearchStats
+{
+    size_t postings_scored = 0;
+    size_t postings_total = 0;
+    bool is_exact = false;
+};
 
 class SearchServer
 {
 private:
-    struct DocumentData
+    using Query = SearchQuery;
+
+    // Слова документа без стоп-слов: различные слова по возрастанию с числом вхождений.
+    struct DocumentWords
     {
-        int rating;
-        DocumentStatus status;
-        std::vector<std::string> words_list;
+        std::vector<std::pair<std::string_view, uint32_t>> word_counts;
+        size_t word_count = 0;
     };
 
-    struct QueryWord
+    // Документ пакета AddDocuments; текст и рейтинги принадлежат вызывающему.
+    struct BatchDocument
     {
-        std::string_view data;
-        bool is_minus;
-        bool is_stop;
+        int id;
+        std::string_view text;
+        DocumentStatus status;
+        const std::vector<int>* ratings;
     };
 
-    struct Query
+    // IDF терма, вычисленный для поколения индекса epoch. Любое изменение индекса устаревает все значения разом,
+    // а пересчёт откладывается до первого обращения к терму. Константные методы могут пересчитывать одно значение
+    // одновременно из разных потоков, но записывают одно и то же число, поэтому блокировка не нужна.
+    struct CachedInverseDocumentFreq
     {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        static constexpr uint64_t NO_EPOCH = std::numeric_limits<uint64_t>::max();
+
+        std::atomic<uint64_t> epoch{ NO_EPOCH };
+        std::atomic<double> value{ 0.0 };
+
+        CachedInverseDocumentFreq() = default;
+        CachedInverseDocumentFreq(const CachedInverseDocumentFreq& other)
+            : epoch(other.epoch.load(std::memory_order_relaxed)), value(other.value.load(std::memory_order_relaxed)){}
     };
 
-    std::set<std::string> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string, double>> freqs_by_id_;
-    std::map<int, DocumentData> documents_;
+    FrozenStringSet stop_words_;
+    TermDictionary terms_;
+    std::vector<PostingList> postings_;
+    mutable std::vector<CachedInverseDocumentFreq> term_idfs_;
+    // упорядоченные по вкладу копии списков вхождений; заполняются, только если включены
+    std::vector<ImpactPostings> impact_postings_;
+    bool is_impact_ordered_ = false;
+    PostingCodec posting_codec_ = PostingCodec::PLAIN;
     std::set<int> document_ids_;
 
+    // Документы хранятся в плотных слотах: внешний id -> слот, атрибуты слота лежат в параллельных массивах.
+    std::map<int, int> document_slots_;
+    std::vector<int> slot_document_ids_;
+    std::vector<DocumentStatus> slot_statuses_;
+    std::vector<int> slot_ratings_;
+    std::vector<double> slot_inv_word_counts_;
+    // длины документов без стоп-слов и их сумма по занятым слотам - для нормировки BM25
+    std::vector<uint32_t> slot_word_counts_;
+    uint64_t total_word_count_ = 0;
+    // занятые слоты каждого статуса; поддерживаются при выделении и освобождении слота
+    std::array<SlotBitmap, static_cast<size_t>(DocumentStatus::REMOVED) + 1> status_slots_;
+    // прямой индекс: термы документа в порядке возрастания слов
+    std::vector<std::vector<TermOccurrence>> slot_terms_;
+    std::vector<int> free_slots_;
+    // буфер разбора AddDocument, чтобы не выделять память под слова на каждый документ
+    std::vector<std::string_view> word_buffer_;
+
+    // растёт при каждом изменении набора документов: по нему кэши результатов узнают об устаревании
+    uint64_t generation_ = 0;
+
+    size_t thread_count_ = std::max(1u, std::thread::hardware_concurrency());
+    constexpr static size_t min_slots_per_thread_ = 1024;
+    constexpr static size_t min_documents_per_shard_ = 256;
+    // предел памяти под накопители релевантности одной группы запросов пакетного поиска
+    constexpr static size_t max_batch_accumulator_bytes_ = 64 << 20;
+
     template <typename StringCollection>
     void SetStopWords(const StringCollection& stop_words);
 
     bool IsStopWord(const std::string_view& word) const;
     bool IsValidWord(const std::string_view& word) const;
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view& text) const;
+    void SplitIntoWordsNoStop(const std::string_view& text, std::vector<std::string_view>& words) const;
     static int ComputeAverageRating(const std::vector<int>& ratings);
-    QueryWord ParseQueryWord(const std::string_view& text) const;
+    int AllocateSlot(int document_id, DocumentStatus status, int rating, uint32_t word_count);
+    int FindSlot(int document_id) const;
+    void CheckNewDocumentId(int document_id) const;
+    DocumentWords ParseDocument(const std::string_view& document, std::vector<std::string_view>& words) const;
+    int InternTerm(const std::string_view& word);
+    void AddPosting(int term_id, int slot, uint32_t count);
+    void RemovePosting(const TermOccurrence& occurrence, int slot);
+    uint32_t FindTermCount(int slot, int term_id) const;
+    void AddDocumentBatch(const std::vector<BatchDocument>& batch, size_t shard_count);
 
     template <typename ExecutionPolicy>
     Query ParseQuery(const ExecutionPolicy& policy, const std::string_view& text) const;
     Query ParseQuery(const std::string_view& text) const;
-    double ComputeWordInverseDocumentFreq(const std::string_view& word) const;
+    void ParseQuery(const std::string_view& text, QueryContext& context) const;
+    const PostingList* FindPostingList(const std::string_view& word) const;
+    double ComputeWordInverseDocumentFreq(const PostingList& postings) const;
+    DocumentLengths GetDocumentLengths() const;
+    // пересчитывает IDF всех термов сразу, например после пакетной загрузки
+    void RefreshInverseDocumentFreqs();
+
+    double ComputeTermFreq(uint32_t count, int slot) const
+    {
+        return count * slot_inv_word_counts_[slot];
+    }
+
+    // Слоты, которые не попадут в выдачу: вхождения минус-слов запроса и слоты, которые отвергает распознанная
+    // часть предиката (document_predicates.h). Строятся до подсчёта релевантности, и цикл по плюс-словам пропускает их,
+    // не вызывая предикат; для каждого вхождения проверяется только GetRemainingPredicate(document_predicate).
+    template <typename DocumentPredicate>
+    SlotBitmap BuildExcludedSlots(const Query& query, const DocumentPredicate& document_predicate) const;
+    template <typename DocumentPredicate>
+    void BuildExcludedSlots(const Query& query, const DocumentPredicate& document_predicate, SlotBitmap& excluded_slots) const;
+    void ExcludeMinusWordSlots(const Query& query, SlotBitmap& excluded_slots) const;
+
+    // Статус проверяется по битовой карте статуса. Отрезки рейтинга и id дешевле сравнить прямо с атрибутом слота,
+    // чем строить для них карту на каждый запрос, поэтому они остаются в оставшемся предикате, как и любые лямбды.
+    void ExcludeRejectedSlots(StatusIs predicate, SlotBitmap& excluded_slots) const;
+    template <typename Left, typename Right>
+    void ExcludeRejectedSlots(const BothPredicates<Left, Right>& predicate, SlotBitmap& excluded_slots) const;
+    template <typename DocumentPredicate>
+    void ExcludeRejectedSlots([[maybe_unused]] const DocumentPredicate& predicate, [[maybe_unused]] SlotBitmap& excluded_slots) const{}
 
+    static AnyDocument GetRemainingPredicate([[maybe_unused]] StatusIs predicate)
+    {
+        return {};
+    }
+    template <typename Left, typename Right>
+    static auto GetRemainingPredicate(const BothPredicates<Left, Right>& predicate);
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate) const;
+    static DocumentPredicate GetRemainingPredicate(const DocumentPredicate& predicate)
+    {
+        return predicate;
+    }
+
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query,
+                                           const SlotBitmap& excluded_slots, DocumentPredicate document_predicate) const;
+    // Найденные документы пишутся в буферы context (в его documents_), накопители берутся оттуда же.
+    template <typename RankingModel, typename DocumentPredicate>
+    void FindAllDocuments(const Query& query, const SlotBitmap& excluded_slots, DocumentPredicate document_predicate, QueryContext& context) const;
+    // inverse_document_freq(номер плюс-слова, его список вхождений) возвращает IDF слова
+    template <typename RankingModel, typename DocumentPredicate, typename InverseDocumentFreq>
+    void FindAllDocuments(const Query& query, const SlotBitmap& excluded_slots, DocumentPredicate document_predicate,
+                          InverseDocumentFreq inverse_document_freq, QueryContext& context) const;
 
     void SortAndRemoveDublicates(std::vector<std::string_view>& dummy) const;
 
@@ -81,18 +208,94 @@ public:
 
     void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Пакетная загрузка из диапазона элементов (id, text, status, ratings) - структур или кортежей.
+    // Индекс получается тем же, что и после поочерёдных AddDocument; если хоть один документ некорректен,
+    // исключение бросается до изменения индекса и не добавляется ни один документ.
+    template <typename ExecutionPolicy, typename DocumentRange>
+    void AddDocuments(const ExecutionPolicy& policy, const DocumentRange& documents);
+    template <typename DocumentRange>
+    void AddDocuments(const DocumentRange& documents);
+    // Переносит документы source, для которых keep(document_id) истинно, с теми же словами, статусом и рейтингом,
+    // не разбирая текст заново. Релевантность перенесённых документов не меняется; используется при слиянии сегментов.
+    // Как и AddDocuments, при недопустимом id бросает исключение до изменения индекса.
+    template <typename DocumentFilter>
+    void AddDocumentsFrom(const SearchServer& source, DocumentFilter keep);
+
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const;
-    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
     std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
 
+    // Поиск в буферах вызывающего (query_context.h): когда их ёмкость дорастёт до размера индекса и запросов,
+    // поиск перестаёт выделять память. Результат совпадает с FindTopDocuments и действителен до следующего поиска с context.
+    // Поиск без контекста берёт контекст своего потока и выделяет память только под возвращаемую копию результата.
+    template <typename DocumentPredicate>
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                  size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, const std::string_view& raw_query,
+                                                  DocumentStatus status = DocumentStatus::ACTUAL, size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Поиск с моделью ранжирования из ranking_models.h, например FindTopDocuments<Bm25Ranking>(raw_query, DocumentStatus::ACTUAL).
+    // Без явной модели ранжирует TfIdfRanking. Модель выбирается при компиляции и не добавляет работы в цикл по вхождениям.
+    template <typename RankingModel, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename RankingModel>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename RankingModel, typename DocumentPredicate>
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                  size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename RankingModel>
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, const std::string_view& raw_query,
+                                                  DocumentStatus status = DocumentStatus::ACTUAL, size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
     template <typename ExecutionPolicy, typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
     template <typename ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentStatus status,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query) const;
 
+    // MaxScore: пропускает документы, которые заведомо не попадут в top_k. Результат совпадает с FindTopDocuments.
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsPruned(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                 size_t top_k = MAX_RESULT_DOCUMENT_COUNT, PruningStats* stats = nullptr) const;
+    std::vector<Document> FindTopDocumentsPruned(const std::string_view& raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                 size_t top_k = MAX_RESULT_DOCUMENT_COUNT, PruningStats* stats = nullptr) const;
+
+    // Поиск по вкладу (score-at-a-time): сегменты упорядоченных по вкладу списков всех плюс-слов обходятся
+    // от большего вклада к меньшему. Без бюджета поиск останавливается, как только top_k доказуемо определён,
+    // и результат совпадает с FindTopDocuments. С бюджетом обход прерывается после max_postings вхождений
+    // и возвращаются лучшие из найденных документов. Требует SetImpactOrderedPostings(true), иначе std::logic_error.
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsByImpact(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                   size_t top_k = MAX_RESULT_DOCUMENT_COUNT, size_t max_postings = NO_POSTINGS_BUDGET,
+                                                   ImpactSearchStats* stats = nullptr) const;
+    std::vector<Document> FindTopDocumentsByImpact(const std::string_view& raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                   size_t top_k = MAX_RESULT_DOCUMENT_COUNT, size_t max_postings = NO_POSTINGS_BUDGET,
+                                                   ImpactSearchStats* stats = nullptr) const;
+
+    // Для распределённого поиска (ShardedSearchServer): число документов со словом и поиск по разобранному запросу
+    // с IDF, посчитанными снаружи по всем шардам, - по одному на каждое плюс-слово запроса.
+    size_t GetDocumentFreq(const std::string_view& word) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsWithIdf(const SearchQuery& query, const std::vector<double>& inverse_document_freqs,
+                                                  DocumentPredicate document_predicate, size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Пакетный поиск: запросы разбираются заранее, каждый терм пакета ищется в словаре и раскодируется один раз,
+    // вклад вхождения считается один раз и добавляется всем запросам с этим термом.
+    // Результат совпадает с FindTopDocuments(query, status, top_k) для каждого запроса.
+    // Накопители плотные (слот x запрос), поэтому на больших индексах метод обычно медленнее независимых запросов
+    // и ProcessQueries им не пользуется.
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                                             DocumentStatus status = DocumentStatus::ACTUAL,
+                                                             size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
     auto begin() const   //1 done
     {
         return document_ids_.begin();
@@ -104,12 +307,33 @@ public:
     }
 
     size_t GetDocumentCount() const;
+    bool HasDocument(int document_id) const;
+    uint64_t GetIndexGeneration() const;
+
+    // Каноническая запись запроса: плюс- и минус-слова без стоп-слов и повторов, по возрастанию.
+    // Запросы с одинаковой записью дают одинаковый результат при одинаковом фильтре.
+    std::string NormalizeQuery(const std::string_view& raw_query) const;
+
+    void SetThreadCount(size_t thread_count);
+    size_t GetThreadCount() const;
+
+    // по умолчанию PLAIN: VARINT занимает в несколько раз меньше памяти, но поиск по нему медленнее
+    void SetPostingCodec(PostingCodec codec);
+    PostingCodec GetPostingCodec() const;
+    // Упорядоченные по вкладу списки вхождений для FindTopDocumentsByImpact; по умолчанию не строятся.
+    void SetImpactOrderedPostings(bool enabled);
+    bool HasImpactOrderedPostings() const;
+    // Память, занятая списками вхождений, в байтах.
+    size_t GetIndexMemoryUsage() const;
+
+    // Сохраняет индекс в снимок для MappedSearchServer (index_snapshot.h); бросает std::runtime_error при ошибке записи.
+    void SaveSnapshot(const std::string& path) const;
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::parallel_policy, std::string_view raw_query, int document_id) const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::sequenced_policy, std::string_view raw_query, int document_id) const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
 
-    const std::map<std::string, double>& GetWordFrequencies(int document_id) const;
+    WordFrequencies GetWordFrequencies(int document_id) const;
 
     void RemoveDocument(int document_id);   // 3 done
     void RemoveDocument(const std::execution::parallel_policy&, int document_id);
@@ -126,7 +350,8 @@ void SearchServer::SetStopWords(const StringCollection& stop_words)
 {
     using std::string_literals::operator""s;
 
-    for (const std::string_view& word : stop_words)
+    std::vector<std::string_view> words;
+    for (const std::string_view word : stop_words)
     {
         if (word != ""s)
         {
@@ -138,13 +363,14 @@ void SearchServer::SetStopWords(const StringCollection& stop_words)
 //            {
 //                throw std::invalid_argument( "Invalid stop words"s  + (std::string)word + "found"s );
 //            }
-            stop_words_.insert(std::string(word));
+            words.push_back(word);
         }
         else
         {
             throw std::invalid_argument( "Empty string was passed to vector"s );
         }
     }
+    stop_words_ = FrozenStringSet(words);
 }
 
 template <typename StringCollection>
@@ -153,44 +379,82 @@ SearchServer::SearchServer(const StringCollection& stop_words)
     SetStopWords(stop_words);
 }
 
+template <typename ExecutionPolicy, typename DocumentRange>
+void SearchServer::AddDocuments([[maybe_unused]] const ExecutionPolicy& policy, const DocumentRange& documents)
+{
+    std::vector<BatchDocument> batch;
+    for (const auto& [document_id, text, status, ratings] : documents)
+    {
+        batch.push_back({ document_id, text, status, &ratings });
+    }
+
+    const bool is_parallel = std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::parallel_policy>;
+    AddDocumentBatch(batch, is_parallel ? thread_count_ : 1);
+    ++generation_;
+    RefreshInverseDocumentFreqs();
+}
+
+template <typename DocumentRange>
+void SearchServer::AddDocuments(const DocumentRange& documents)
+{
+    AddDocuments(std::execution::seq, documents);
+}
+
+template <typename DocumentFilter>
+void SearchServer::AddDocumentsFrom(const SearchServer& source, DocumentFilter keep)
+{
+    for (const auto& [document_id, source_slot] : source.document_slots_)
+    {
+        if (keep(document_id))
+        {
+            CheckNewDocumentId(document_id);
+        }
+    }
+    for (const auto& [document_id, source_slot] : source.document_slots_)
+    {
+        if (!keep(document_id))
+        {
+            continue;
+        }
+        const int slot = AllocateSlot(document_id, source.slot_statuses_[source_slot], source.slot_ratings_[source_slot],
+                                      source.slot_word_counts_[source_slot]);
+        // прямой индекс source упорядочен по словам, переводятся только номера термов
+        std::vector<TermOccurrence>& occurrences = slot_terms_[slot];
+        occurrences.reserve(source.slot_terms_[source_slot].size());
+        for (const TermOccurrence& occurrence : source.slot_terms_[source_slot])
+        {
+            const int term_id = InternTerm(source.terms_.GetTerm(occurrence.term_id));
+            AddPosting(term_id, slot, occurrence.count);
+            occurrences.push_back({ term_id, occurrence.count });
+        }
+        document_ids_.insert(document_id);
+    }
+    ++generation_;
+}
+
 template <typename ExecutionPolicy, typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentPredicate document_predicate) const
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                     size_t top_k) const
 {
     if constexpr (!std::is_same<typename std::decay<ExecutionPolicy>::type, std::execution::parallel_policy>::value)
     {
-        return FindTopDocuments(raw_query, document_predicate);
+        return FindTopDocuments(raw_query, document_predicate, top_k);
     }
     else
     {
         const Query& query = ParseQuery(raw_query);
-        std::vector<Document> matched_documents = FindAllDocuments(policy, query, document_predicate);
-        sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs)
-        {
-            if (std::abs(lhs.relevance - rhs.relevance) < EPSILON)
-            {
-                return lhs.rating > rhs.rating;
-            }
-            else
-            {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
-
-        if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
-        {
-            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-        }
+        std::vector<Document> matched_documents = FindAllDocuments(policy, query, BuildExcludedSlots(query, document_predicate),
+                                                                   GetRemainingPredicate(document_predicate));
+        SelectTopDocuments(policy, matched_documents, top_k);
         return matched_documents;
     }
 }
 
 template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentStatus status) const
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentStatus status,
+                                                     size_t top_k) const
 {
-    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating)
-    {
-        return document_status == status;
-    });
+    return FindTopDocuments(policy, raw_query, StatusIs{ status }, top_k);
 }
 
 template <typename ExecutionPolicy>
@@ -200,147 +464,719 @@ std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& poli
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t top_k) const
+{
+    ThreadQueryContext thread_context;
+    return FindTopDocuments(thread_context.Get(), raw_query, document_predicate, top_k);
+}
+
+template <typename DocumentPredicate>
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, const std::string_view& raw_query,
+                                                            DocumentPredicate document_predicate, size_t top_k) const
+{
+    return FindTopDocuments<TfIdfRanking>(context, raw_query, document_predicate, top_k);
+}
+
+template <typename RankingModel, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t top_k) const
+{
+    ThreadQueryContext thread_context;
+    return FindTopDocuments<RankingModel>(thread_context.Get(), raw_query, document_predicate, top_k);
+}
+
+template <typename RankingModel>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t top_k) const
+{
+    return FindTopDocuments<RankingModel>(raw_query, StatusIs{ status }, top_k);
+}
+
+template <typename RankingModel, typename DocumentPredicate>
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, const std::string_view& raw_query,
+                                                            DocumentPredicate document_predicate, size_t top_k) const
+{
+    ParseQuery(raw_query, context);
+    BuildExcludedSlots(context.query_, document_predicate, context.excluded_slots_);
+    FindAllDocuments<RankingModel>(context.query_, context.excluded_slots_, GetRemainingPredicate(document_predicate), context);
+    SelectTopDocuments(context.documents_, top_k, context.top_buffer_);
+    return context.documents_;
+}
+
+template <typename RankingModel>
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, const std::string_view& raw_query, DocumentStatus status,
+                                                            size_t top_k) const
+{
+    return FindTopDocuments<RankingModel>(context, raw_query, StatusIs{ status }, top_k);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsWithIdf(const SearchQuery& query, const std::vector<double>& inverse_document_freqs,
+                                                            DocumentPredicate document_predicate, size_t top_k) const
+{
+    ThreadQueryContext thread_context;
+    QueryContext& context = thread_context.Get();
+    BuildExcludedSlots(query, document_predicate, context.excluded_slots_);
+    FindAllDocuments<TfIdfRanking>(query, context.excluded_slots_, GetRemainingPredicate(document_predicate),
+                                   [&inverse_document_freqs](size_t word_index, [[maybe_unused]] const PostingList& postings)
+    {
+        return inverse_document_freqs[word_index];
+    }, context);
+    SelectTopDocuments(context.documents_, top_k, context.top_buffer_);
+    return context.documents_;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsPruned(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                           size_t top_k, PruningStats* stats) const
 {
     const auto query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs)
+
+    struct TermBound
+    {
+        const PostingList* postings;
+        double inverse_document_freq;
+        double max_score;
+        int term_id;
+        size_t query_index;
+    };
+
+    std::vector<TermBound> terms;
+    size_t total_postings = 0;
+    for (const std::string_view& word : query.plus_words)
     {
-        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON)
+        const PostingList* postings = FindPostingList(word);
+        if (postings != nullptr && !postings->empty())
         {
-            return lhs.rating > rhs.rating;
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(*postings);
+            terms.push_back({postings, inverse_document_freq, postings->GetMaxTermFreq() * inverse_document_freq,
+                             static_cast<int>(postings - postings_.data()), terms.size()});
+            total_postings += postings->size();
         }
-        else
+    }
+
+    // курсоры занимают несколько килобайт, поэтому место под них выделяется заранее и они не копируются
+    std::vector<PostingList::Cursor> minus_cursors;
+    minus_cursors.reserve(query.minus_words.size());
+    for (const std::string_view& word : query.minus_words)
+    {
+        const PostingList* postings = FindPostingList(word);
+        if (postings != nullptr && !postings->empty())
         {
-            return lhs.relevance > rhs.relevance;
+            minus_cursors.emplace_back(*postings);
         }
-    });
+    }
 
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+    // Термы упорядочены по возрастанию максимального вклада. Префикс термов, чья суммарная граница ниже порога,
+    // не может сам по себе вывести документ в top_k: кандидаты берутся только из остальных ("существенных") термов.
+    std::sort(terms.begin(), terms.end(), [](const TermBound& lhs, const TermBound& rhs)
+    {
+        return lhs.max_score < rhs.max_score;
+    });
+    std::vector<PostingList::Cursor> cursors;
+    cursors.reserve(terms.size());
+    std::vector<double> bound_prefix(terms.size());
+    std::vector<size_t> query_order(terms.size());
+    for (size_t i = 0; i < terms.size(); ++i)
     {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        cursors.emplace_back(*terms[i].postings);
+        bound_prefix[i] = (i == 0 ? 0.0 : bound_prefix[i - 1]) + terms[i].max_score;
+        query_order[terms[i].query_index] = i;
     }
-    return matched_documents;
-}
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate) const
-{
-    int num_of_threads = std::thread::hardware_concurrency();
-    if (num_of_threads <= 1)
+    TopDocumentsHeap heap(top_k);
+    double threshold = -std::numeric_limits<double>::infinity();
+    size_t first_essential = 0;
+    size_t scored_postings = 0;
+
+    // Существенные термы обходятся окнами слотов: их вклады складываются в плотные аккумуляторы окна,
+    // как в FindAllDocuments, а несущественные проверяются только у набравших достаточную оценку кандидатов.
+    constexpr int WINDOW_SIZE = 2048;
+    // во сколько раз поиск вхождения по кандидату дороже последовательного прохода по вхождению
+    constexpr size_t SEEK_COST = 8;
+    const auto estimate_window_postings = [this](const TermBound& term)
     {
-        return FindAllDocuments(query, document_predicate);
-    }
+        return term.postings->size() * WINDOW_SIZE / std::max<size_t>(slot_document_ids_.size(), 1);
+    };
+    std::vector<double> window_scores(WINDOW_SIZE);
+    std::vector<uint8_t> is_window_matched(WINDOW_SIZE);
+    struct Candidate
+    {
+        int slot;
+        double score;
+    };
+    std::vector<Candidate> candidates;
+    candidates.reserve(WINDOW_SIZE);
+    // несущественные термы, которые в текущем окне ищутся по кандидатам, и суммы их границ
+    std::vector<uint8_t> is_seek_term(terms.size());
+    std::vector<size_t> seek_terms;
+    std::vector<double> seek_bound_prefix;
 
-    ConcurrentMap<int, double> document_to_relevance(num_of_threads);
-    std::for_each(policy, query.plus_words.begin(), query.plus_words.end(), [&](std::string_view word)
+    while (top_k > 0 && first_essential < terms.size())
     {
-        if (word_to_document_freqs_.count(word) != 0)
+        int window_begin = std::numeric_limits<int>::max();
+        for (size_t i = first_essential; i < terms.size(); ++i)
+        {
+            if (!cursors[i].AtEnd())
+            {
+                window_begin = std::min(window_begin, cursors[i].Slot());
+            }
+        }
+        if (window_begin == std::numeric_limits<int>::max())
+        {
+            break;
+        }
+        const int window_end = window_begin + WINDOW_SIZE;
+        // набор существенных термов меняется только между окнами
+        const size_t window_first_essential = first_essential;
+
+        // Вхождения несущественного терма в окне дешевле пройти подряд, если кандидатов много по сравнению с ними;
+        // иначе терм ищется отдельно по каждому кандидату.
+        size_t candidate_estimate = 0;
+        for (size_t i = window_first_essential; i < terms.size(); ++i)
+        {
+            candidate_estimate += estimate_window_postings(terms[i]);
+        }
+        seek_terms.clear();
+        seek_bound_prefix.clear();
+        for (size_t i = 0; i < window_first_essential; ++i)
+        {
+            is_seek_term[i] = candidate_estimate * SEEK_COST < estimate_window_postings(terms[i]) ? 1 : 0;
+            if (is_seek_term[i])
+            {
+                seek_terms.push_back(i);
+                seek_bound_prefix.push_back((seek_bound_prefix.empty() ? 0.0 : seek_bound_prefix.back()) + terms[i].max_score);
+            }
+        }
+
+        // Остальные термы складываются в порядке слов запроса, как в FindAllDocuments: если искать по кандидатам
+        // нечего, оценка кандидата совпадает с его релевантностью бит в бит. Кандидатов дают только существенные термы.
+        for (const size_t i : query_order)
+        {
+            if (i < window_first_essential && is_seek_term[i])
+            {
+                continue;
+            }
+            // курсор несущественного терма мог отстать от окна
+            cursors[i].Seek(window_begin);
+            const double inverse_document_freq = terms[i].inverse_document_freq;
+            const uint8_t is_essential = i >= window_first_essential ? 1 : 0;
+            cursors[i].ForEachBefore(window_end, [&](int slot, uint32_t count)
+            {
+                window_scores[slot - window_begin] += ComputeTermFreq(count, slot) * inverse_document_freq;
+                is_window_matched[slot - window_begin] |= is_essential;
+                ++scored_postings;
+            });
+        }
+
+        candidates.clear();
+        const double seek_bound = seek_bound_prefix.empty() ? 0.0 : seek_bound_prefix.back();
+        for (int offset = 0; offset < WINDOW_SIZE; ++offset)
         {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+            const double score = window_scores[offset];
+            window_scores[offset] = 0.0;
+            if (!is_window_matched[offset])
+            {
+                continue;
+            }
+            is_window_matched[offset] = 0;
+            if (score + seek_bound < threshold)
+            {
+                continue;
+            }
 
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
+            const int slot = window_begin + offset;
+            bool is_candidate = document_predicate(slot_document_ids_[slot], slot_statuses_[slot], slot_ratings_[slot]);
+            for (PostingList::Cursor& minus_cursor : minus_cursors)
             {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating))
+                if (!is_candidate)
                 {
-                    ConcurrentMap<int, double>::Access val = document_to_relevance[document_id];
-                    val.ref_to_value += term_freq * inverse_document_freq;
+                    break;
                 }
+                minus_cursor.Seek(slot);
+                is_candidate = minus_cursor.AtEnd() || minus_cursor.Slot() != slot;
+            }
+            if (is_candidate)
+            {
+                candidates.push_back({slot, score});
             }
         }
-    });
 
-    std::for_each(policy, query.minus_words.begin(), query.minus_words.end(), [&](std::string_view word)
-    {
-        if (word_to_document_freqs_.count(word) != 0)
+        // термы добавляются от большего вклада к меньшему; кандидат отбрасывается, как только ему не хватает
+        // даже вкладов всех оставшихся, а граница блока позволяет сделать это, не раскодируя блок
+        for (size_t k = seek_terms.size(); k-- > 0 && !candidates.empty();)
         {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word))
+            const size_t i = seek_terms[k];
+            PostingList::Cursor& cursor = cursors[i];
+            const double inverse_document_freq = terms[i].inverse_document_freq;
+            const double rest_bound = k == 0 ? 0.0 : seek_bound_prefix[k - 1];
+            size_t kept_count = 0;
+            for (Candidate& candidate : candidates)
             {
-                document_to_relevance.erase(document_id);
+                if (candidate.score + seek_bound_prefix[k] < threshold)
+                {
+                    continue;
+                }
+                cursor.SeekBlock(candidate.slot);
+                if (candidate.score + cursor.GetBlockMaxTermFreq() * inverse_document_freq + rest_bound < threshold)
+                {
+                    continue;
+                }
+                cursor.Seek(candidate.slot);
+                if (!cursor.AtEnd() && cursor.Slot() == candidate.slot)
+                {
+                    candidate.score += ComputeTermFreq(cursor.Count(), candidate.slot) * inverse_document_freq;
+                    ++scored_postings;
+                }
+                candidates[kept_count++] = candidate;
             }
+            candidates.resize(kept_count);
         }
-    });
 
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap())
+        for (const Candidate& candidate : candidates)
+        {
+            if (candidate.score < threshold)
+            {
+                continue;
+            }
+            const int slot = candidate.slot;
+            double relevance = candidate.score;
+            if (!seek_terms.empty())
+            {
+                // вклады найденных по кандидатам термов добавлены не по порядку: релевантность считается заново
+                relevance = 0.0;
+                for (const size_t i : query_order)
+                {
+                    const uint32_t count = FindTermCount(slot, terms[i].term_id);
+                    if (count > 0)
+                    {
+                        relevance += ComputeTermFreq(count, slot) * terms[i].inverse_document_freq;
+                    }
+                }
+            }
+            heap.Push({slot_document_ids_[slot], relevance, slot_ratings_[slot]});
+
+            if (heap.IsFull())
+            {
+                // документ с релевантностью в пределах EPSILON от худшего ещё может вытеснить его за счёт рейтинга
+                threshold = heap.GetWorst().relevance - EPSILON;
+                while (first_essential < terms.size() && bound_prefix[first_essential] < threshold)
+                {
+                    ++first_essential;
+                }
+            }
+        }
+    }
+
+    if (stats != nullptr)
     {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+        stats->postings_scored += scored_postings;
+        stats->postings_skipped += total_postings - scored_postings;
     }
-    return matched_documents;
+    return heap.Extract();
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const
+std::vector<Document> SearchServer::FindTopDocumentsByImpact(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                             size_t top_k, size_t max_postings, ImpactSearchStats* stats) const
 {
-    std::map<int, double> document_to_relevance;
+    using std::string_literals::operator""s;
+    if (!is_impact_ordered_)
+    {
+        throw std::logic_error("Impact-ordered postings are not built"s);
+    }
+    const auto query = ParseQuery(raw_query);
 
+    // термы в порядке слов запроса: в нём складываются вклады, как в FindAllDocuments
+    std::vector<int> term_ids;
+    std::vector<double> inverse_document_freqs;
     for (const std::string_view& word : query.plus_words)
     {
-        if (word_to_document_freqs_.count(word) == 0)
+        const PostingList* postings = FindPostingList(word);
+        if (postings != nullptr && !postings->empty())
         {
-            continue;
+            term_ids.push_back(static_cast<int>(postings - postings_.data()));
+            inverse_document_freqs.push_back(ComputeWordInverseDocumentFreq(*postings));
+        }
+    }
+    std::vector<const PostingList*> minus_postings;
+    for (const std::string_view& word : query.minus_words)
+    {
+        const PostingList* postings = FindPostingList(word);
+        if (postings != nullptr && !postings->empty())
+        {
+            minus_postings.push_back(postings);
+        }
+    }
+
+    struct SegmentBound
+    {
+        size_t term;
+        const ImpactPostings::Segment* segment;
+        double max_score;
+        // граница следующего сегмента того же терма
+        double next_max_score;
+    };
+
+    const size_t term_count = term_ids.size();
+    std::vector<SegmentBound> segments;
+    size_t total_postings = 0;
+    for (size_t term = 0; term < term_count; ++term)
+    {
+        for (const ImpactPostings::Segment& segment : impact_postings_[term_ids[term]].GetSegments())
+        {
+            segments.push_back({term, &segment, segment.max_term_freq * inverse_document_freqs[term], 0.0});
+            total_postings += segment.slots.size();
+        }
+    }
+    std::stable_sort(segments.begin(), segments.end(), [](const SegmentBound& lhs, const SegmentBound& rhs)
+    {
+        return lhs.max_score > rhs.max_score;
+    });
+    // верхняя граница вклада терма в документ, ещё не встреченный в его списке
+    std::vector<double> remaining_bounds(term_count, 0.0);
+    for (auto it = segments.rbegin(); it != segments.rend(); ++it)
+    {
+        it->next_max_score = remaining_bounds[it->term];
+        remaining_bounds[it->term] = it->max_score;
+    }
+
+    // Накопители: строка вкладов по термам для каждого встреченного документа; нулевой вклад - терм ещё не встречен.
+    const int NO_ROW = -1;
+    const int REJECTED_ROW = -2;
+    std::vector<int> slot_rows(slot_document_ids_.size(), NO_ROW);
+    std::vector<int> row_slots;
+    std::vector<double> contributions;
+    std::vector<double> lower_bounds;
+
+    // Top_k определён, если ни встреченный вне его, ни ещё не встреченный документ не может набрать
+    // релевантность ближе EPSILON к k-й нижней границе. Тогда в top_rows - строки этих k документов.
+    std::vector<size_t> top_rows;
+    const auto is_top_settled = [&]
+    {
+        if (lower_bounds.size() < top_k)
+        {
+            return false;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
+        std::vector<double> sorted_bounds = lower_bounds;
+        std::nth_element(sorted_bounds.begin(), sorted_bounds.begin() + (top_k - 1), sorted_bounds.end(), std::greater<>());
+        const double threshold = sorted_bounds[top_k - 1] - EPSILON;
+        if (std::accumulate(remaining_bounds.begin(), remaining_bounds.end(), 0.0) >= threshold)
         {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating))
+            return false;
+        }
+        top_rows.clear();
+        for (size_t row = 0; row < lower_bounds.size(); ++row)
+        {
+            double upper_bound = lower_bounds[row];
+            for (size_t term = 0; term < term_count; ++term)
             {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+                upper_bound += contributions[row * term_count + term] == 0.0 ? remaining_bounds[term] : 0.0;
+            }
+            if (upper_bound >= threshold)
+            {
+                top_rows.push_back(row);
+                if (top_rows.size() > top_k)
+                {
+                    return false;
+                }
             }
         }
-    }
+        return true;
+    };
 
-    for (const std::string_view& word : query.minus_words)
+    size_t scored_postings = 0;
+    size_t next_check = top_k;
+    size_t position = 0;
+    bool is_settled = false;
+    for (; top_k > 0 && position < segments.size() && scored_postings < max_postings; ++position)
     {
-        if (word_to_document_freqs_.count(word) == 0)
+        const SegmentBound& bound = segments[position];
+        const ImpactPostings::Segment& segment = *bound.segment;
+        const size_t segment_size = std::min(segment.slots.size(), max_postings - scored_postings);
+        for (size_t i = 0; i < segment_size; ++i)
         {
-            continue;
+            const int slot = segment.slots[i];
+            int& row = slot_rows[slot];
+            if (row == NO_ROW)
+            {
+                const bool is_candidate = document_predicate(slot_document_ids_[slot], slot_statuses_[slot], slot_ratings_[slot])
+                    && std::none_of(minus_postings.begin(), minus_postings.end(), [slot](const PostingList* postings)
+                    {
+                        return postings->Contains(slot);
+                    });
+                row = is_candidate ? static_cast<int>(row_slots.size()) : REJECTED_ROW;
+                if (is_candidate)
+                {
+                    row_slots.push_back(slot);
+                    contributions.resize(contributions.size() + term_count, 0.0);
+                    lower_bounds.push_back(0.0);
+                }
+            }
+            if (row != REJECTED_ROW)
+            {
+                const double contribution = ComputeTermFreq(segment.counts[i], slot) * inverse_document_freqs[bound.term];
+                contributions[row * term_count + bound.term] = contribution;
+                lower_bounds[row] += contribution;
+            }
+        }
+        scored_postings += segment_size;
+        if (segment_size < segment.slots.size())
+        {
+            break;
+        }
+        remaining_bounds[bound.term] = bound.next_max_score;
+
+        // проверка стоит O(встреченных документов), поэтому делается всё реже
+        if (scored_postings >= next_check && position + 1 < segments.size())
+        {
+            next_check = scored_postings + std::max(scored_postings / 4, top_k);
+            if (is_top_settled())
+            {
+                is_settled = true;
+                break;
+            }
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word))
+    }
+    const bool is_exhausted = !is_settled && position == segments.size();
+
+    std::vector<size_t> result_rows;
+    if (is_settled)
+    {
+        result_rows = std::move(top_rows);
+    }
+    else
+    {
+        result_rows.resize(lower_bounds.size());
+        std::iota(result_rows.begin(), result_rows.end(), 0);
+        if (!is_exhausted && result_rows.size() > top_k)
         {
-            document_to_relevance.erase(document_id);
+            // бюджет исчерпан: берутся лучшие по уже набранной релевантности
+            std::nth_element(result_rows.begin(), result_rows.begin() + top_k, result_rows.end(), [&lower_bounds](size_t lhs, size_t rhs)
+            {
+                return lower_bounds[lhs] > lower_bounds[rhs];
+            });
+            result_rows.resize(top_k);
         }
     }
 
+    // вклады из непросмотренных сегментов дочитываются из прямого индекса; документы выдаются по возрастанию слота, как в FindAllDocuments
+    std::sort(result_rows.begin(), result_rows.end(), [&row_slots](size_t lhs, size_t rhs)
+    {
+        return row_slots[lhs] < row_slots[rhs];
+    });
     std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance)
+    for (const size_t row : result_rows)
     {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+        const int slot = row_slots[row];
+        double relevance = 0.0;
+        for (size_t term = 0; term < term_count; ++term)
+        {
+            double contribution = contributions[row * term_count + term];
+            if (contribution == 0.0 && !is_exhausted)
+            {
+                contribution = ComputeTermFreq(FindTermCount(slot, term_ids[term]), slot) * inverse_document_freqs[term];
+            }
+            relevance += contribution;
+        }
+        matched_documents.push_back({slot_document_ids_[slot], relevance, slot_ratings_[slot]});
+    }
+    SelectTopDocuments(matched_documents, top_k);
+
+    if (stats != nullptr)
+    {
+        stats->postings_scored += scored_postings;
+        stats->postings_total += total_postings;
+        stats->is_exact = is_settled || is_exhausted;
     }
     return matched_documents;
 }
 
-template <typename ExecutionPolicy>
-SearchServer::Query SearchServer::ParseQuery([[__maybe_unused__]]const ExecutionPolicy& policy, const std::string_view& text) const
+template <typename DocumentPredicate>
+SlotBitmap SearchServer::BuildExcludedSlots(const Query& query, const DocumentPredicate& document_predicate) const
 {
-    Query result;
-    auto& min_words = result.minus_words;
-    auto& pls_words = result.plus_words;
+    SlotBitmap excluded_slots;
+    BuildExcludedSlots(query, document_predicate, excluded_slots);
+    return excluded_slots;
+}
 
-    auto words = SplitIntoWords(text);
-    if constexpr (!std::is_same<typename std::decay<ExecutionPolicy>::type, std::execution::parallel_policy>::value)
+template <typename DocumentPredicate>
+void SearchServer::BuildExcludedSlots(const Query& query, const DocumentPredicate& document_predicate, SlotBitmap& excluded_slots) const
+{
+    excluded_slots.Clear(slot_document_ids_.size());
+    ExcludeMinusWordSlots(query, excluded_slots);
+    ExcludeRejectedSlots(document_predicate, excluded_slots);
+}
+
+template <typename Left, typename Right>
+void SearchServer::ExcludeRejectedSlots(const BothPredicates<Left, Right>& predicate, SlotBitmap& excluded_slots) const
+{
+    ExcludeRejectedSlots(predicate.left, excluded_slots);
+    ExcludeRejectedSlots(predicate.right, excluded_slots);
+}
+
+template <typename Left, typename Right>
+auto SearchServer::GetRemainingPredicate(const BothPredicates<Left, Right>& predicate)
+{
+    auto left = GetRemainingPredicate(predicate.left);
+    auto right = GetRemainingPredicate(predicate.right);
+    if constexpr (std::is_same<decltype(left), AnyDocument>::value)
+    {
+        return right;
+    }
+    else if constexpr (std::is_same<decltype(right), AnyDocument>::value)
+    {
+        return left;
+    }
+    else
+    {
+        return BothPredicates<decltype(left), decltype(right)>{ left, right };
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments([[maybe_unused]] const std::execution::parallel_policy& policy, const Query& query,
+                                                     const SlotBitmap& excluded_slots, DocumentPredicate document_predicate) const
+{
+    const size_t slot_count = slot_document_ids_.size();
+    const size_t thread_count = std::min(thread_count_, slot_count / min_slots_per_thread_);
+    if (thread_count <= 1)
+    {
+        ThreadQueryContext thread_context;
+        FindAllDocuments<TfIdfRanking>(query, excluded_slots, document_predicate, thread_context.Get());
+        return thread_context.Get().documents_;
+    }
+
+    std::vector<std::pair<const PostingList*, double>> plus_postings;
+    for (const std::string_view& word : query.plus_words)
     {
-        SortAndRemoveDublicates(words);
+        const PostingList* postings = FindPostingList(word);
+        if (postings != nullptr && !postings->empty())
+        {
+            plus_postings.emplace_back(postings, ComputeWordInverseDocumentFreq(*postings));
+        }
     }
 
-    for (const std::string_view& word : words)
+    // Слоты делятся на непересекающиеся диапазоны. Каждый поток копит релевантность в своём плотном массиве
+    // и сам проходит по своему отрезку каждого списка вхождений, поэтому блокировки не нужны.
+    const size_t range_size = (slot_count + thread_count - 1) / thread_count;
+    std::vector<std::future<std::vector<Document>>> range_results;
+    for (size_t first = 0; first < slot_count; first += range_size)
     {
-        const auto& query_word = ParseQueryWord(word);
-        if (!query_word.is_stop)
+        const int first_slot = static_cast<int>(first);
+        const int last_slot = static_cast<int>(std::min(first + range_size, slot_count));
+
+        range_results.push_back(std::async(std::launch::async, [&, first_slot, last_slot]
         {
-            if (query_word.is_minus)
+            std::vector<double> document_to_relevance(last_slot - first_slot);
+            std::vector<char> is_matched(last_slot - first_slot);
+
+            for (const auto& [postings, inverse_document_freq] : plus_postings)
             {
-                min_words.push_back(query_word.data);
+                PostingList::Cursor cursor(*postings);
+                for (cursor.Seek(first_slot); !cursor.AtEnd() && cursor.Slot() < last_slot; cursor.Next())
+                {
+                    const int slot = cursor.Slot();
+                    if (!excluded_slots.Test(slot) && document_predicate(slot_document_ids_[slot], slot_statuses_[slot], slot_ratings_[slot]))
+                    {
+                        document_to_relevance[slot - first_slot] += ComputeTermFreq(cursor.Count(), slot) * inverse_document_freq;
+                        is_matched[slot - first_slot] = 1;
+                    }
+                }
             }
-            else
+
+            std::vector<Document> matched_documents;
+            for (int slot = first_slot; slot < last_slot; ++slot)
             {
-                pls_words.push_back(query_word.data);
+                if (is_matched[slot - first_slot])
+                {
+                    matched_documents.push_back({slot_document_ids_[slot], document_to_relevance[slot - first_slot], slot_ratings_[slot]});
+                }
             }
+            return matched_documents;
+        }));
+    }
+
+    std::vector<Document> matched_documents;
+    for (auto& range_result : range_results)
+    {
+        const std::vector<Document> range_documents = range_result.get();
+        matched_documents.insert(matched_documents.end(), range_documents.begin(), range_documents.end());
+    }
+    return matched_documents;
+}
+
+template <typename RankingModel, typename DocumentPredicate>
+void SearchServer::FindAllDocuments(const Query& query, const SlotBitmap& excluded_slots, DocumentPredicate document_predicate,
+                                    QueryContext& context) const
+{
+    FindAllDocuments<RankingModel>(query, excluded_slots, document_predicate, [this]([[maybe_unused]] size_t word_index, const PostingList& postings)
+    {
+        if constexpr (std::is_same<RankingModel, TfIdfRanking>::value)
+        {
+            return ComputeWordInverseDocumentFreq(postings);
+        }
+        else
+        {
+            return RankingModel::ComputeInverseDocumentFreq(GetDocumentCount(), postings.size());
         }
+    }, context);
+}
+
+template <typename RankingModel, typename DocumentPredicate, typename InverseDocumentFreq>
+void SearchServer::FindAllDocuments(const Query& query, const SlotBitmap& excluded_slots, DocumentPredicate document_predicate,
+                                    InverseDocumentFreq compute_inverse_document_freq, QueryContext& context) const
+{
+    const size_t slot_count = slot_document_ids_.size();
+    std::vector<double>& document_to_relevance = context.relevances_;
+    std::vector<uint8_t>& is_matched = context.is_matched_;
+    document_to_relevance.assign(slot_count, 0.0);
+    is_matched.assign(slot_count, 0);
+    const DocumentLengths document_lengths = GetDocumentLengths();
+
+    for (size_t word_index = 0; word_index < query.plus_words.size(); ++word_index)
+    {
+        const PostingList* postings = FindPostingList(query.plus_words[word_index]);
+        if (postings == nullptr || postings->empty())
+        {
+            continue;
+        }
+        const auto term_score = RankingModel::MakeTermScore(compute_inverse_document_freq(word_index, *postings), document_lengths);
+        postings->ForEachBlock([&](const PostingList::Block& block)
+        {
+            if constexpr (std::is_same<DocumentPredicate, AnyDocument>::value)
+            {
+                // фильтр целиком в исключённых слотах: атрибуты слотов не читаются
+                AccumulateTermScores(block.slots, block.counts, block.size, excluded_slots, term_score,
+                                     document_to_relevance.data(), is_matched.data());
+                return;
+            }
+            for (size_t i = 0; i < block.size; ++i)
+            {
+                const int slot = block.slots[i];
+                if (!excluded_slots.Test(slot) && document_predicate(slot_document_ids_[slot], slot_statuses_[slot], slot_ratings_[slot]))
+                {
+                    document_to_relevance[slot] += term_score(block.counts[i], slot);
+                    is_matched[slot] = 1;
+                }
+            }
+        });
     }
-    return result;
+
+    std::vector<int>& matched_slots = context.matched_slots_;
+    matched_slots.clear();
+    CollectMatchedSlots(GetBestScoringKernel(), is_matched.data(), slot_count, excluded_slots, matched_slots);
+    std::vector<Document>& matched_documents = context.documents_;
+    matched_documents.clear();
+    for (const int slot : matched_slots)
+    {
+        matched_documents.push_back({slot_document_ids_[slot], document_to_relevance[slot], slot_ratings_[slot]});
+    }
+}
+
+template <typename ExecutionPolicy>
+SearchServer::Query SearchServer::ParseQuery([[__maybe_unused__]]const ExecutionPolicy& policy, const std::string_view& text) const
+{
+    const bool is_parallel = std::is_same<typename std::decay<ExecutionPolicy>::type, std::execution::parallel_policy>::value;
+    return ParseSearchQuery(text, stop_words_, !is_parallel);
 }
 
 #endif // SEARCH_SERVER_H
@@ -0,0 +1,293 @@
+#include "segmented_search_server.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+using std::string_literals::operator""s;
+
+SegmentedSearchServer::SegmentedSearchServer(const std::string& stop_words, size_t write_segment_capacity)
+    : SegmentedSearchServer(SplitIntoWords(stop_words), write_segment_capacity){}
+
+SegmentedSearchServer::~SegmentedSearchServer()
+{
+    {
+        std::lock_guard lock(merge_mutex_);
+        is_stopping_ = true;
+    }
+    merge_requested_.notify_one();
+    merge_thread_.join();
+}
+
+void SegmentedSearchServer::Initialize()
+{
+    merge_thread_ = std::thread([this]
+    {
+        RunMerges();
+    });
+}
+
+//--------------------запись------------------//
+void SegmentedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
+{
+    bool is_frozen = false;
+    {
+        std::unique_lock lock(index_mutex_);
+        if (document_ids_.count(document_id) > 0)
+        {
+            throw std::invalid_argument("Document with such ID"s + std::to_string(document_id) + "already exists");
+        }
+        write_segment_->AddDocument(document_id, document, status, ratings);
+        document_ids_.insert(document_id);
+        if (write_segment_->GetDocumentCount() >= write_segment_capacity_)
+        {
+            FreezeWriteSegment();
+            is_frozen = true;
+        }
+    }
+    if (is_frozen)
+    {
+        RequestMerge();
+    }
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id)
+{
+    std::unique_lock lock(index_mutex_);
+    if (document_ids_.erase(document_id) == 0)
+    {
+        return;
+    }
+    if (write_segment_->HasDocument(document_id))
+    {
+        write_segment_->RemoveDocument(document_id);
+        return;
+    }
+    for (Segment& segment : segments_)
+    {
+        if (segment.index->HasDocument(document_id) && segment.tombstones.count(document_id) == 0)
+        {
+            AddTombstone(segment, document_id);
+            return;
+        }
+    }
+}
+
+void SegmentedSearchServer::Flush()
+{
+    {
+        std::unique_lock lock(index_mutex_);
+        if (write_segment_->GetDocumentCount() == 0)
+        {
+            return;
+        }
+        FreezeWriteSegment();
+    }
+    RequestMerge();
+}
+
+void SegmentedSearchServer::FreezeWriteSegment()
+{
+    segments_.push_back({ std::shared_ptr<const SearchServer>(std::move(write_segment_)), {}, {} });
+    write_segment_ = std::make_unique<SearchServer>(stop_words_list_);
+}
+
+void SegmentedSearchServer::AddTombstone(Segment& segment, int document_id)
+{
+    segment.tombstones.insert(document_id);
+    for (const auto& [word, frequency] : segment.index->GetWordFrequencies(document_id))
+    {
+        ++segment.tombstoned_document_freqs[word];
+    }
+}
+
+//--------------------слияние------------------//
+size_t SegmentedSearchServer::GetTier(size_t document_count, size_t write_segment_capacity)
+{
+    size_t tier = 0;
+    for (size_t tier_size = write_segment_capacity * MERGE_FACTOR; document_count >= tier_size; tier_size *= MERGE_FACTOR)
+    {
+        ++tier;
+    }
+    return tier;
+}
+
+void SegmentedSearchServer::RequestMerge()
+{
+    {
+        std::lock_guard lock(merge_mutex_);
+        has_merge_request_ = true;
+    }
+    merge_requested_.notify_one();
+}
+
+void SegmentedSearchServer::WaitForMerges()
+{
+    std::unique_lock lock(merge_mutex_);
+    merges_finished_.wait(lock, [this]
+    {
+        return !has_merge_request_ && !is_merging_;
+    });
+    if (merge_error_)
+    {
+        std::rethrow_exception(std::exchange(merge_error_, nullptr));
+    }
+}
+
+void SegmentedSearchServer::RunMerges()
+{
+    std::unique_lock lock(merge_mutex_);
+    while (true)
+    {
+        merge_requested_.wait(lock, [this]
+        {
+            return has_merge_request_ || is_stopping_;
+        });
+        if (is_stopping_)
+        {
+            return;
+        }
+        has_merge_request_ = false;
+        is_merging_ = true;
+        lock.unlock();
+        // исключение не должно завершить программу из фонового потока: сегменты меняются только после удачного слияния,
+        // поэтому ошибка просто откладывается до WaitForMerges
+        std::exception_ptr error;
+        try
+        {
+            while (MergeOnce())
+            {
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+        if (error)
+        {
+            merge_error_ = error;
+        }
+        is_merging_ = false;
+        merges_finished_.notify_all();
+    }
+}
+
+bool SegmentedSearchServer::MergeOnce()
+{
+    // Под разделяемой блокировкой выбираются MERGE_FACTOR самых старых сегментов одного уровня
+    // и запоминаются их метки. Сами сегменты неизменяемы, поэтому слияние идёт без блокировки.
+    std::vector<std::shared_ptr<const SearchServer>> sources;
+    std::vector<std::unordered_set<int>> source_tombstones;
+    {
+        std::shared_lock lock(index_mutex_);
+        std::unordered_map<size_t, std::vector<size_t>> tiers;
+        for (size_t i = 0; i < segments_.size(); ++i)
+        {
+            const size_t live_count = segments_[i].index->GetDocumentCount() - segments_[i].tombstones.size();
+            std::vector<size_t>& tier = tiers[GetTier(live_count, write_segment_capacity_)];
+            tier.push_back(i);
+            if (tier.size() == MERGE_FACTOR)
+            {
+                for (const size_t index : tier)
+                {
+                    sources.push_back(segments_[index].index);
+                    source_tombstones.push_back(segments_[index].tombstones);
+                }
+                break;
+            }
+        }
+    }
+    if (sources.empty())
+    {
+        return false;
+    }
+
+    auto merged = std::make_shared<SearchServer>(stop_words_list_);
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        const std::unordered_set<int>& tombstones = source_tombstones[i];
+        merged->AddDocumentsFrom(*sources[i], [&tombstones](int document_id)
+        {
+            return tombstones.count(document_id) == 0;
+        });
+    }
+
+    // Документы, помеченные удалёнными во время слияния, помечаются и в новом сегменте.
+    std::unique_lock lock(index_mutex_);
+    Segment merged_segment{ merged, {}, {} };
+    size_t position = segments_.size();
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        const auto it = std::find_if(segments_.begin(), segments_.end(), [&source = sources[i]](const Segment& segment)
+        {
+            return segment.index == source;
+        });
+        for (const int document_id : it->tombstones)
+        {
+            if (source_tombstones[i].count(document_id) == 0)
+            {
+                AddTombstone(merged_segment, document_id);
+            }
+        }
+        position = std::min(position, static_cast<size_t>(it - segments_.begin()));
+        segments_.erase(it);
+    }
+    // новый сегмент встаёт на место самого старого из слитых, порядок сегментов по возрасту сохраняется
+    segments_.insert(segments_.begin() + position, std::move(merged_segment));
+    return true;
+}
+
+//--------------------поиск------------------//
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t top_k) const
+{
+    return FindTopDocuments(raw_query, StatusIs{ status }, top_k);
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query) const
+{
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SegmentedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const
+{
+    std::shared_lock lock(index_mutex_);
+    if (document_ids_.count(document_id) > 0)
+    {
+        if (write_segment_->HasDocument(document_id))
+        {
+            return write_segment_->MatchDocument(raw_query, document_id);
+        }
+        for (const Segment& segment : segments_)
+        {
+            if (segment.index->HasDocument(document_id) && segment.tombstones.count(document_id) == 0)
+            {
+                return segment.index->MatchDocument(raw_query, document_id);
+            }
+        }
+    }
+    throw std::out_of_range("Document out of range");
+}
+
+size_t SegmentedSearchServer::GetDocumentCount() const
+{
+    std::shared_lock lock(index_mutex_);
+    return document_ids_.size();
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const
+{
+    std::shared_lock lock(index_mutex_);
+    return segments_.size() + 1;
+}
+
+size_t SegmentedSearchServer::GetTombstoneCount() const
+{
+    std::shared_lock lock(index_mutex_);
+    size_t tombstone_count = 0;
+    for (const Segment& segment : segments_)
+    {
+        tombstone_count += segment.tombstones.size();
+    }
+    return tombstone_count;
+}
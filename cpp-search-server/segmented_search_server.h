@@ -0,0 +1,161 @@
+#pragma once
+#include "document.h"
+#include "frozen_string_set.h"
+#include "search_query.h"
+#include "search_server.h"
+#include "string_processing.h"
+#include "top_documents.h"
+
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Сегментированный индекс в духе LSM. Новые документы попадают в небольшой изменяемый сегмент записи;
+// заполнившись, он замораживается в неизменяемый сегмент. Фоновый поток сливает сегменты по уровням:
+// как только на одном уровне (размер в пределах одной степени MERGE_FACTOR) набирается MERGE_FACTOR сегментов,
+// они сливаются в один. Удаление из замороженного сегмента - метка (tombstone): документ исключается при поиске,
+// не учитывается в IDF и физически удаляется при слиянии. Поиск идёт по всем сегментам с общими IDF,
+// поэтому релевантность совпадает с одним SearchServer с теми же документами.
+class SegmentedSearchServer
+{
+public:
+    static constexpr size_t MERGE_FACTOR = 4;
+    static constexpr size_t DEFAULT_WRITE_SEGMENT_CAPACITY = 1024;
+
+    template <typename StringCollection>
+    explicit SegmentedSearchServer(const StringCollection& stop_words, size_t write_segment_capacity = DEFAULT_WRITE_SEGMENT_CAPACITY);
+    explicit SegmentedSearchServer(const std::string& stop_words, size_t write_segment_capacity = DEFAULT_WRITE_SEGMENT_CAPACITY);
+    ~SegmentedSearchServer();
+
+    SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+    SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    size_t GetDocumentCount() const;
+    // замороженные сегменты и сегмент записи
+    size_t GetSegmentCount() const;
+    size_t GetTombstoneCount() const;
+
+    // Замораживает сегмент записи, не дожидаясь его заполнения.
+    void Flush();
+    // Ждёт, пока фоновый поток не сольёт всё, что можно слить. Если слияние завершилось исключением,
+    // бросает его; слитые сегменты при этом остаются прежними.
+    void WaitForMerges();
+
+private:
+    struct Segment
+    {
+        std::shared_ptr<const SearchServer> index;
+        std::unordered_set<int> tombstones;
+        // сколько помеченных удалёнными документов сегмента содержат слово; слова указывают в словарь index
+        std::unordered_map<std::string_view, size_t> tombstoned_document_freqs;
+    };
+
+    std::vector<std::string> stop_words_list_;
+    FrozenStringSet stop_words_;
+    size_t write_segment_capacity_;
+
+    // сегменты, сегмент записи и множество id; поиск берёт разделяемую блокировку
+    mutable std::shared_mutex index_mutex_;
+    std::vector<Segment> segments_;
+    std::unique_ptr<SearchServer> write_segment_;
+    std::set<int> document_ids_;
+
+    std::mutex merge_mutex_;
+    std::condition_variable merge_requested_;
+    std::condition_variable merges_finished_;
+    bool has_merge_request_ = false;
+    bool is_merging_ = false;
+    bool is_stopping_ = false;
+    std::exception_ptr merge_error_;
+    std::thread merge_thread_;
+
+    void Initialize();
+    // требуют эксклюзивной блокировки index_mutex_
+    void FreezeWriteSegment();
+    static void AddTombstone(Segment& segment, int document_id);
+
+    void RequestMerge();
+    void RunMerges();
+    bool MergeOnce();
+    static size_t GetTier(size_t document_count, size_t write_segment_capacity);
+};
+
+template <typename StringCollection>
+SegmentedSearchServer::SegmentedSearchServer(const StringCollection& stop_words, size_t write_segment_capacity)
+    : write_segment_capacity_(std::max<size_t>(write_segment_capacity, 1))
+{
+    // конструктор SearchServer проверяет стоп-слова
+    write_segment_ = std::make_unique<SearchServer>(stop_words);
+    for (const std::string_view word : stop_words)
+    {
+        stop_words_list_.emplace_back(word);
+    }
+    stop_words_ = FrozenStringSet(stop_words_list_);
+    Initialize();
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t top_k) const
+{
+    const SearchQuery query = ParseSearchQuery(raw_query, stop_words_, true);
+    std::shared_lock lock(index_mutex_);
+
+    // IDF по живым документам всех сегментов: помеченные удалёнными вычитаются
+    std::vector<double> inverse_document_freqs;
+    inverse_document_freqs.reserve(query.plus_words.size());
+    for (const std::string_view word : query.plus_words)
+    {
+        size_t document_freq = write_segment_->GetDocumentFreq(word);
+        for (const Segment& segment : segments_)
+        {
+            document_freq += segment.index->GetDocumentFreq(word);
+            const auto it = segment.tombstoned_document_freqs.find(word);
+            document_freq -= it == segment.tombstoned_document_freqs.end() ? 0 : it->second;
+        }
+        inverse_document_freqs.push_back(document_freq == 0 ? 0.0 : std::log(document_ids_.size() * 1.0 / document_freq));
+    }
+
+    std::vector<Document> matched_documents = write_segment_->FindTopDocumentsWithIdf(query, inverse_document_freqs, document_predicate, top_k);
+    for (const Segment& segment : segments_)
+    {
+        std::vector<Document> segment_documents;
+        if (segment.tombstones.empty())
+        {
+            segment_documents = segment.index->FindTopDocumentsWithIdf(query, inverse_document_freqs, document_predicate, top_k);
+        }
+        else
+        {
+            segment_documents = segment.index->FindTopDocumentsWithIdf(query, inverse_document_freqs,
+            [&segment, &document_predicate](int document_id, DocumentStatus status, int rating)
+            {
+                return segment.tombstones.count(document_id) == 0 && document_predicate(document_id, status, rating);
+            }, top_k);
+        }
+        matched_documents.insert(matched_documents.end(), segment_documents.begin(), segment_documents.end());
+    }
+    SelectTopDocuments(matched_documents, top_k);
+    return matched_documents;
+}
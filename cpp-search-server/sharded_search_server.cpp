@@ -0,0 +1,59 @@
+#include "sharded_search_server.h"
+
+#include <stdexcept>
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const std::string& stop_words)
+    : ShardedSearchServer(shard_count, SplitIntoWords(stop_words)){}
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count)
+    : ShardedSearchServer(shard_count, std::vector<std::string_view>{}){}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const
+{
+    return static_cast<unsigned>(document_id) % shards_.size();
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
+{
+    shards_[GetShardIndex(document_id)]->AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id)
+{
+    shards_[GetShardIndex(document_id)]->RemoveDocument(document_id);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t top_k) const
+{
+    return FindTopDocuments(raw_query, StatusIs{ status }, top_k);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query) const
+{
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const
+{
+    return shards_[GetShardIndex(document_id)]->MatchDocument(raw_query, document_id);
+}
+
+size_t ShardedSearchServer::GetDocumentCount() const
+{
+    size_t document_count = 0;
+    for (const auto& shard : shards_)
+    {
+        document_count += shard->GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const
+{
+    return shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t shard_index) const
+{
+    return *shards_.at(shard_index);
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include "document.h"
+#include "frozen_string_set.h"
+#include "search_query.h"
+#include "search_server.h"
+#include "string_processing.h"
+#include "top_documents.h"
+
+#include <cmath>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Поиск по шардам с IDF, посчитанными по всем шардам сразу: запрос разбирается один раз, шарды ищут параллельно,
+// их top_k сливаются. shards - диапазон указателей на SearchServer.
+template <typename ShardRange, typename DocumentPredicate>
+std::vector<Document> FindTopDocumentsInShards(const ShardRange& shards, const FrozenStringSet& stop_words, std::string_view raw_query,
+                                               DocumentPredicate document_predicate, size_t top_k);
+
+// Поисковый сервер из нескольких шардов SearchServer: документ хранится в шарде с номером id mod числа шардов.
+// Запрос разбирается один раз, IDF плюс-слов считаются по всем шардам, поиск идёт во всех шардах параллельно,
+// а их top_k сливаются. Результат совпадает с одним SearchServer с теми же документами
+// (с точностью до порядка документов с одинаковыми релевантностью и рейтингом).
+class ShardedSearchServer
+{
+public:
+    template <typename StringCollection>
+    ShardedSearchServer(size_t shard_count, const StringCollection& stop_words);
+    ShardedSearchServer(size_t shard_count, const std::string& stop_words);
+    explicit ShardedSearchServer(size_t shard_count);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    size_t GetDocumentCount() const;
+    size_t GetShardCount() const;
+    const SearchServer& GetShard(size_t shard_index) const;
+
+private:
+    // SearchServer не перемещается, поэтому шарды лежат по указателям
+    std::vector<std::unique_ptr<SearchServer>> shards_;
+    FrozenStringSet stop_words_;
+
+    size_t GetShardIndex(int document_id) const;
+};
+
+template <typename ShardRange, typename DocumentPredicate>
+std::vector<Document> FindTopDocumentsInShards(const ShardRange& shards, const FrozenStringSet& stop_words, std::string_view raw_query,
+                                               DocumentPredicate document_predicate, size_t top_k)
+{
+    const SearchQuery query = ParseSearchQuery(raw_query, stop_words, true);
+
+    size_t document_count = 0;
+    for (const auto& shard : shards)
+    {
+        document_count += shard->GetDocumentCount();
+    }
+    std::vector<double> inverse_document_freqs;
+    inverse_document_freqs.reserve(query.plus_words.size());
+    for (const std::string_view word : query.plus_words)
+    {
+        size_t document_freq = 0;
+        for (const auto& shard : shards)
+        {
+            document_freq += shard->GetDocumentFreq(word);
+        }
+        // та же формула, что и в SearchServer; для слов без документов IDF не используется
+        inverse_document_freqs.push_back(document_freq == 0 ? 0.0 : std::log(document_count * 1.0 / document_freq));
+    }
+
+    const auto find_in_shard = [&](const auto& shard)
+    {
+        return shard->FindTopDocumentsWithIdf(query, inverse_document_freqs, document_predicate, top_k);
+    };
+    std::vector<std::future<std::vector<Document>>> shard_results;
+    for (auto it = std::next(std::begin(shards)); it != std::end(shards); ++it)
+    {
+        shard_results.push_back(std::async(std::launch::async, [&find_in_shard, it]
+        {
+            return find_in_shard(*it);
+        }));
+    }
+    // глобальный top_k содержится в объединении top_k шардов
+    std::vector<Document> matched_documents = find_in_shard(*std::begin(shards));
+    for (auto& shard_result : shard_results)
+    {
+        const std::vector<Document> shard_documents = shard_result.get();
+        matched_documents.insert(matched_documents.end(), shard_documents.begin(), shard_documents.end());
+    }
+    SelectTopDocuments(matched_documents, top_k);
+    return matched_documents;
+}
+
+template <typename StringCollection>
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const StringCollection& stop_words)
+{
+    for (size_t i = 0; i < std::max<size_t>(shard_count, 1); ++i)
+    {
+        // конструктор шарда проверяет стоп-слова
+        shards_.push_back(std::make_unique<SearchServer>(stop_words));
+    }
+    stop_words_ = FrozenStringSet(stop_words);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t top_k) const
+{
+    return FindTopDocumentsInShards(shards_, stop_words_, raw_query, document_predicate, top_k);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Множество слотов документов: по биту на слот. Слоты за пределами размера считаются отсутствующими.
+class SlotBitmap
+{
+public:
+    SlotBitmap() = default;
+    explicit SlotBitmap(size_t slot_count)
+        : words_((slot_count + WORD_BITS - 1) / WORD_BITS){}
+
+    void Resize(size_t slot_count)
+    {
+        words_.resize((slot_count + WORD_BITS - 1) / WORD_BITS);
+    }
+
+    // пустая карта на slot_count слотов; память прежней карты переиспользуется
+    void Clear(size_t slot_count)
+    {
+        words_.assign((slot_count + WORD_BITS - 1) / WORD_BITS, 0);
+    }
+
+    void Set(int slot)
+    {
+        words_[slot / WORD_BITS] |= uint64_t{1} << (slot % WORD_BITS);
+    }
+
+    void Reset(int slot)
+    {
+        words_[slot / WORD_BITS] &= ~(uint64_t{1} << (slot % WORD_BITS));
+    }
+
+    bool Test(int slot) const
+    {
+        const size_t word = slot / WORD_BITS;
+        return word < words_.size() && (words_[word] >> (slot % WORD_BITS) & 1) != 0;
+    }
+
+    // слово карты со слотами [64 * index, 64 * index + 63]; за пределами карты - пустое
+    uint64_t GetWord(size_t index) const
+    {
+        return index < words_.size() ? words_[index] : 0;
+    }
+
+    // память под слова карты, в байтах
+    size_t GetMemoryUsage() const
+    {
+        return words_.capacity() * sizeof(uint64_t);
+    }
+
+    // добавляет все слоты, которых нет в карте other того же размера
+    void UniteWithComplement(const SlotBitmap& other)
+    {
+        for (size_t word = 0; word < words_.size(); ++word)
+        {
+            words_[word] |= ~other.words_[word];
+        }
+    }
+
+private:
+    static constexpr size_t WORD_BITS = 64;
+
+    std::vector<uint64_t> words_;
+};
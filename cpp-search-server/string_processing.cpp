@@ -1,31 +1,182 @@
 #include "string_processing.h"
 
-std::vector<std::string_view> SplitIntoWords(std::string_view text)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TOKENIZER_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#include <cstdint>
+
+namespace
 {
-    std::vector<std::string_view> words;
+const size_t NO_CONTROL = std::string_view::npos;
+
+void EmitWord(std::string_view text, size_t& word_begin, size_t space, std::vector<std::string_view>& words)
+{
+    if (space > word_begin)
+    {
+        words.push_back(text.substr(word_begin, space - word_begin));
+    }
+    word_begin = space + 1;
+}
+
+// Все функции разбора возвращают позицию первого управляющего символа или NO_CONTROL.
+size_t SplitScalar(std::string_view text, size_t position, size_t& word_begin, bool check_controls, std::vector<std::string_view>& words)
+{
+    for (; position < text.size(); ++position)
+    {
+        const unsigned char c = static_cast<unsigned char>(text[position]);
+        if (c == ' ')
+        {
+            EmitWord(text, word_begin, position, words);
+        }
+        else if (check_controls && c < ' ')
+        {
+            return position;
+        }
+    }
+    return NO_CONTROL;
+}
 
-    auto word_begin_iter = text.begin();
-    auto word_end_iter = text.end();
+#ifdef TOKENIZER_X86_SIMD
+// space_mask - биты пробелов в блоке, начинающемся с position
+inline void EmitWords(std::string_view text, size_t position, uint32_t space_mask, size_t& word_begin, std::vector<std::string_view>& words)
+{
+    while (space_mask != 0)
+    {
+        EmitWord(text, word_begin, position + __builtin_ctz(space_mask), words);
+        space_mask &= space_mask - 1;
+    }
+}
 
+__attribute__((target("sse2")))
+size_t SplitSse2(std::string_view text, size_t& word_begin, bool check_controls, std::vector<std::string_view>& words)
+{
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i max_control = _mm_set1_epi8(' ' - 1);
+    size_t position = 0;
+    for (; position + 16 <= text.size(); position += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + position));
+        if (check_controls)
+        {
+            // беззнаковое c <= 31: min(c, 31) == c; байты UTF-8 (>= 0x80) управляющими не считаются
+            const uint32_t controls = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(chunk, max_control), chunk));
+            if (controls != 0)
+            {
+                return position + __builtin_ctz(controls);
+            }
+        }
+        EmitWords(text, position, _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, spaces)), word_begin, words);
+    }
+    return SplitScalar(text, position, word_begin, check_controls, words);
+}
 
-    for (auto i = text.begin(); i < text.end(); ++i)
+__attribute__((target("avx2")))
+size_t SplitAvx2(std::string_view text, size_t& word_begin, bool check_controls, std::vector<std::string_view>& words)
+{
+    const __m256i spaces = _mm256_set1_epi8(' ');
+    const __m256i max_control = _mm256_set1_epi8(' ' - 1);
+    size_t position = 0;
+    for (; position + 32 <= text.size(); position += 32)
     {
-        if (*i == ' ')
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + position));
+        if (check_controls)
         {
-            word_end_iter = i;
-            if (*word_begin_iter != ' ' && word_begin_iter != word_end_iter)
+            const uint32_t controls = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(chunk, max_control), chunk));
+            if (controls != 0)
             {
-                words.push_back(text.substr(
-                    std::distance(text.begin(), word_begin_iter),
-                    std::distance(word_begin_iter, word_end_iter)));
+                return position + __builtin_ctz(controls);
             }
-            word_begin_iter = std::next(word_end_iter);
         }
+        EmitWords(text, position, _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, spaces)), word_begin, words);
+    }
+    return SplitScalar(text, position, word_begin, check_controls, words);
+}
+#endif
+
+TokenizerKernel DetectTokenizerKernel()
+{
+#ifdef TOKENIZER_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return TokenizerKernel::AVX2;
     }
-    if (word_begin_iter != word_end_iter)
+    if (__builtin_cpu_supports("sse2"))
     {
-        words.push_back(text.substr(word_begin_iter - text.begin(),
-            std::distance(word_begin_iter, word_end_iter)));
+        return TokenizerKernel::SSE2;
     }
+#endif
+    return TokenizerKernel::SCALAR;
+}
+
+size_t Split(TokenizerKernel kernel, std::string_view text, bool check_controls, std::vector<std::string_view>& words)
+{
+    size_t word_begin = 0;
+    size_t control = NO_CONTROL;
+    switch (kernel)
+    {
+#ifdef TOKENIZER_X86_SIMD
+    case TokenizerKernel::AVX2:
+        control = SplitAvx2(text, word_begin, check_controls, words);
+        break;
+    case TokenizerKernel::SSE2:
+        control = SplitSse2(text, word_begin, check_controls, words);
+        break;
+#endif
+    default:
+        control = SplitScalar(text, 0, word_begin, check_controls, words);
+        break;
+    }
+
+    if (control == NO_CONTROL)
+    {
+        EmitWord(text, word_begin, text.size(), words);
+    }
+    return control;
+}
+}
+
+TokenizerKernel GetBestTokenizerKernel()
+{
+    static const TokenizerKernel kernel = DetectTokenizerKernel();
+    return kernel;
+}
+
+bool IsTokenizerKernelSupported(TokenizerKernel kernel)
+{
+    return kernel <= GetBestTokenizerKernel();
+}
+
+std::vector<std::string_view> SplitIntoWords(std::string_view text)
+{
+    std::vector<std::string_view> words;
+    Split(GetBestTokenizerKernel(), text, false, words);
     return words;
 }
+
+std::string_view SplitIntoValidWords(std::string_view text, std::vector<std::string_view>& words)
+{
+    return SplitIntoValidWords(GetBestTokenizerKernel(), text, words);
+}
+
+std::string_view SplitIntoValidWords(TokenizerKernel kernel, std::string_view text, std::vector<std::string_view>& words)
+{
+    if (!IsTokenizerKernelSupported(kernel))
+    {
+        kernel = GetBestTokenizerKernel();
+    }
+
+    words.clear();
+    const size_t control = Split(kernel, text, true, words);
+    if (control == NO_CONTROL)
+    {
+        return {};
+    }
+
+    // слово с управляющим символом ограничено ближайшими пробелами
+    const size_t begin = text.rfind(' ', control) + 1;
+    const size_t end = text.find(' ', control);
+    return text.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+}
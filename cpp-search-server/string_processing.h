@@ -3,7 +3,26 @@
 
 
 #include <string>
+#include <string_view>
 #include <vector>
 
+// Набор инструкций, которым текст размечается на слова.
+enum class TokenizerKernel
+{
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+// Лучший набор, поддерживаемый процессором; определяется один раз при первом вызове.
+TokenizerKernel GetBestTokenizerKernel();
+bool IsTokenizerKernelSupported(TokenizerKernel kernel);
+
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
+
+// Однопроходный разбор: слова пишутся в words (буфер очищается, его ёмкость переиспользуется),
+// в том же проходе ищутся управляющие символы (коды 0..31). Возвращает первое слово с управляющим символом
+// или пустую строку, если текст корректен; в первом случае содержимое words не определено.
+std::string_view SplitIntoValidWords(std::string_view text, std::vector<std::string_view>& words);
+std::string_view SplitIntoValidWords(TokenizerKernel kernel, std::string_view text, std::vector<std::string_view>& words);
 #endif // STRING_PROCESSING_H
@@ -2,6 +2,191 @@
 
 using std::string_literals::operator""s;
 
+namespace
+{
+// Подсчёт выделений памяти в потоке теста: operator new заменён во всей тестовой программе,
+// но считает, только пока включён счётчик. Замены не встраиваются, иначе компилятор видит free от указателя из new.
+thread_local bool is_counting_allocations = false;
+thread_local size_t allocation_count = 0;
+
+template <typename Function>
+size_t CountAllocations(Function function)
+{
+    allocation_count = 0;
+    is_counting_allocations = true;
+    function();
+    is_counting_allocations = false;
+    return allocation_count;
+}
+
+// nullptr при нехватке памяти; размер для aligned_alloc округляется до кратного выравниванию
+void* AllocateCounted(size_t size, size_t alignment)
+{
+    if (is_counting_allocations)
+    {
+        ++allocation_count;
+    }
+    size = size == 0 ? 1 : size;
+    if (alignment <= alignof(std::max_align_t))
+    {
+        return std::malloc(size);
+    }
+    if (size > std::numeric_limits<size_t>::max() - alignment)
+    {
+        return nullptr;
+    }
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+// Общий корпус тестов, которые сравнивают разные пути индексации и поиска с обычным SearchServer.
+// "and" в нём - стоп-слово тестовых серверов.
+const std::vector<std::string> CORPUS_WORDS = { "cat"s, "dog"s, "tail"s, "big"s, "eyes"s, "curly"s, "nasty"s, "hat"s, "white"s, "yellow"s, "and"s };
+
+struct CorpusDocument
+{
+    int id;
+    std::string text;
+    DocumentStatus status;
+    std::vector<int> ratings;
+};
+
+// Документ id корпуса - от 1 до 9 слов; при word_forms > 1 к i-му слову дописывается номер формы i % word_forms,
+// чтобы различных слов было больше.
+CorpusDocument MakeCorpusDocument(int id, int word_forms = 1)
+{
+    std::string text;
+    for (int i = 0; i < 1 + id % 9; ++i)
+    {
+        text += CORPUS_WORDS[(id * 7 + i * i * 3) % CORPUS_WORDS.size()];
+        if (word_forms > 1)
+        {
+            text += std::to_string(i % word_forms);
+        }
+        text += " "s;
+    }
+    return { id, text, static_cast<DocumentStatus>(id % 3), { id % 11 - 5 } };
+}
+
+// Запросы к корпусу: одиночное слово, минус-слова, стоп-слово, слово, которого нет в корпусе.
+const std::vector<std::string> CORPUS_QUERIES = { "cat"s, "curly dog -tail"s, "big and eyes white yellow hat"s, "nasty -cat -dog cat"s, "unknown"s };
+
+bool IsSelectedCorpusDocument(int document_id, [[maybe_unused]] DocumentStatus status, int rating)
+{
+    return document_id % 4 != 0 && rating > -3;
+}
+}
+
+// Заменены все формы operator new и delete: обычные, для массивов, nothrow и с выравниванием.
+// Память любой формы берётся из malloc или aligned_alloc и освобождается free, поэтому формы можно смешивать так же,
+// как это допускают стандартные реализации, и санитайзеры не видят несоответствия выделения и освобождения.
+[[gnu::noinline]] void* operator new(size_t size)
+{
+    if (void* pointer = AllocateCounted(size, alignof(std::max_align_t)))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+[[gnu::noinline]] void* operator new(size_t size, std::align_val_t alignment)
+{
+    if (void* pointer = AllocateCounted(size, static_cast<size_t>(alignment)))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+[[gnu::noinline]] void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return AllocateCounted(size, alignof(std::max_align_t));
+}
+
+[[gnu::noinline]] void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return AllocateCounted(size, alignof(std::max_align_t));
+}
+
+[[gnu::noinline]] void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return AllocateCounted(size, static_cast<size_t>(alignment));
+}
+
+[[gnu::noinline]] void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return AllocateCounted(size, static_cast<size_t>(alignment));
+}
+
+[[gnu::noinline]] void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, size_t, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void* pointer, size_t, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
 void AssertImpl(bool value, const std::string& expr_str, const std::string& file, const std::string& func, unsigned line,
     const std::string& hint)
 {
@@ -239,3 +424,1275 @@ void TestCorrectRelevanceCount() {
         ASSERT (doc0.relevance > doc1.relevance || doc0.rating > doc1.rating);
     }
 }
+
+void TestRemoveDocument()
+{
+    SearchServer server("и в на"s);
+
+    server.AddDocument(0, "белый кот и модный ошейник"s,        DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(1, "пушистый кот пушистый хвост"s,       DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+
+    server.RemoveDocument(1);
+    ASSERT_EQUAL(server.GetDocumentCount(), 2u);
+    ASSERT(server.FindTopDocuments("пушистый"s).empty());
+
+    server.RemoveDocument(std::execution::par, 0);
+    ASSERT_EQUAL(server.FindTopDocuments("кот"s).size(), 0u);
+
+    // слова удалённых документов должны корректно находиться после повторного добавления
+    server.AddDocument(3, "пушистый кот"s, DocumentStatus::ACTUAL, {1});
+    const auto found_docs = server.FindTopDocuments("пушистый кот глаза"s);
+    ASSERT_EQUAL(found_docs.size(), 2u);
+    ASSERT_EQUAL(found_docs[0].id, 3);
+    ASSERT_EQUAL(std::get<0>(server.MatchDocument("кот"s, 3)).size(), 1u);
+}
+
+void TestConcurrentMapMatchesMap()
+{
+    // две полосы на тысячи ключей: таблицы много раз перестраиваются, удалённые ячейки переиспользуются
+    ConcurrentMap<int, int> map(2);
+    std::map<int, int> expected;
+    std::mt19937 generator(5);
+    for (int i = 0; i < 20'000; ++i)
+    {
+        const int key = std::uniform_int_distribution<int>(-3'000, 3'000)(generator);
+        if (std::uniform_int_distribution<int>(0, 2)(generator) == 0)
+        {
+            map.erase(key);
+            expected.erase(key);
+        }
+        else
+        {
+            map[key].ref_to_value += i % 7 + 1;
+            expected[key] += i % 7 + 1;
+        }
+    }
+    // удаление отсутствующего ключа и ключа из ещё пустой полосы ничего не меняет
+    map.erase(1'000'000);
+    ConcurrentMap<int, int>(4).erase(1);
+
+    ASSERT(map.BuildOrdinaryMap() == expected);
+    auto entries = map.BuildOrdinaryVector();
+    std::sort(entries.begin(), entries.end());
+    const std::vector<std::pair<int, int>> expected_entries(expected.begin(), expected.end());
+    ASSERT(entries == expected_entries);
+
+    // повторная вставка удалённого ключа начинается со значения по умолчанию
+    map[7].ref_to_value = 42;
+    map.erase(7);
+    ASSERT_EQUAL(map[7].ref_to_value, 0);
+}
+
+void TestConcurrentMapConcurrentAccess()
+{
+    // одни потоки увеличивают счётчики общих ключей, другой вставляет и удаляет свои ключи в тех же полосах,
+    // заставляя их перестраиваться, пока остальные держат Access
+    ConcurrentMap<int, int> map(3);
+    const int key_count = 500;
+    const int thread_count = 4;
+    const int increment_count = 20'000;
+    std::vector<std::future<void>> workers;
+    for (int thread = 0; thread < thread_count; ++thread)
+    {
+        workers.push_back(std::async(std::launch::async, [&map, thread]
+        {
+            for (int i = 0; i < increment_count; ++i)
+            {
+                auto access = map[(i * 7 + thread) % key_count];
+                ++access.ref_to_value;
+            }
+        }));
+    }
+    workers.push_back(std::async(std::launch::async, [&map]
+    {
+        for (int round = 0; round < 20; ++round)
+        {
+            for (int key = key_count; key < key_count + 2'000; ++key)
+            {
+                map[key].ref_to_value = key;
+            }
+            for (int key = key_count; key < key_count + 2'000; ++key)
+            {
+                map.erase(key);
+            }
+        }
+    }));
+    for (auto& worker : workers)
+    {
+        worker.get();
+    }
+
+    const std::map<int, int> counters = map.BuildOrdinaryMap();
+    ASSERT_EQUAL(counters.size(), static_cast<size_t>(key_count));
+    int total = 0;
+    for (const auto& [key, value] : counters)
+    {
+        ASSERT(key < key_count);
+        total += value;
+    }
+    ASSERT_EQUAL(total, thread_count * increment_count);
+}
+
+void TestInverseDocumentFreqFollowsIndexChanges()
+{
+    SearchServer server;
+    server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cat"s, DocumentStatus::ACTUAL, {1});
+
+    // IDF "dog" вычисляется и кэшируется при первом поиске
+    ASSERT_EQUAL(server.FindTopDocuments("dog"s).at(0).relevance, 0.5 * std::log(2.0));
+
+    // новый документ меняет число документов, а значит и IDF уже закэшированного терма
+    server.AddDocument(3, "bird"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(server.FindTopDocuments("dog"s).at(0).relevance, 0.5 * std::log(3.0));
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s).at(0).relevance, std::log(3.0 / 2.0));
+
+    server.RemoveDocument(2);
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s).at(0).relevance, 0.5 * std::log(2.0));
+
+    const std::vector<std::tuple<int, std::string, DocumentStatus, std::vector<int>>> documents = {
+        { 4, "dog"s, DocumentStatus::ACTUAL, {1} },
+        { 5, "fish"s, DocumentStatus::ACTUAL, {1} },
+    };
+    server.AddDocuments(documents);
+    const auto found_docs = server.FindTopDocuments("dog"s);
+    ASSERT_EQUAL(found_docs.size(), 2u);
+    ASSERT_EQUAL(found_docs[0].relevance, std::log(4.0 / 2.0));
+}
+
+void TestScoringKernels()
+{
+    const size_t slot_count = 1000;
+    std::vector<double> inv_word_counts(slot_count);
+    std::vector<uint32_t> word_counts(slot_count);
+    for (size_t slot = 0; slot < slot_count; ++slot)
+    {
+        word_counts[slot] = static_cast<uint32_t>(slot % 37 + 1);
+        inv_word_counts[slot] = 1.0 / word_counts[slot];
+    }
+    SlotBitmap excluded_slots(slot_count);
+    for (size_t slot = 0; slot < slot_count; slot += 5)
+    {
+        excluded_slots.Set(static_cast<int>(slot));
+    }
+
+    std::vector<std::vector<int>> blocks;
+    for (size_t size : { 1u, 3u, 4u, 7u, 8u, 9u, 128u, 200u })
+    {
+        std::vector<int> slots;
+        for (size_t i = 0; i < size; ++i)
+        {
+            slots.push_back(static_cast<int>((i * 997 + size * 13) % slot_count));
+        }
+        std::sort(slots.begin(), slots.end());
+        slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+        blocks.push_back(slots);
+    }
+
+    // накопление: вклады исключённых слотов не считаются, остальные совпадают с подсчётом по одному вхождению
+    const DocumentLengths document_lengths{ inv_word_counts.data(), word_counts.data(), 19.0 };
+    const auto check_accumulate = [&](const auto& make_term_score)
+    {
+        std::vector<double> relevances(slot_count);
+        std::vector<uint8_t> is_matched(slot_count);
+        std::vector<double> expected_relevances(slot_count);
+        for (size_t block = 0; block < blocks.size(); ++block)
+        {
+            const auto term_score = make_term_score(std::log(1.0 + block));
+            std::vector<uint32_t> counts(blocks[block].size());
+            for (size_t i = 0; i < counts.size(); ++i)
+            {
+                counts[i] = static_cast<uint32_t>(i % 5 + 1);
+                if (!excluded_slots.Test(blocks[block][i]))
+                {
+                    expected_relevances[blocks[block][i]] += term_score(counts[i], blocks[block][i]);
+                }
+            }
+            AccumulateTermScores(blocks[block].data(), counts.data(), counts.size(), excluded_slots, term_score, relevances.data(), is_matched.data());
+        }
+        ASSERT(relevances == expected_relevances);
+        for (size_t slot = 0; slot < slot_count; slot += 5)
+        {
+            ASSERT(!is_matched[slot]);
+        }
+    };
+    check_accumulate([&document_lengths](double inverse_document_freq) { return TfIdfRanking::MakeTermScore(inverse_document_freq, document_lengths); });
+    check_accumulate([&document_lengths](double inverse_document_freq) { return Bm25Ranking::MakeTermScore(inverse_document_freq, document_lengths); });
+
+    // сбор: отметки в исключённых слотах отбрасываются, все наборы инструкций дают один результат
+    std::vector<uint8_t> is_matched(slot_count);
+    for (size_t slot = 0; slot < slot_count; slot += 3)
+    {
+        is_matched[slot] = 1;
+    }
+    std::vector<int> expected_slots;
+    CollectMatchedSlots(ScoringKernel::SCALAR, is_matched.data(), slot_count, excluded_slots, expected_slots);
+    ASSERT(!expected_slots.empty());
+    ASSERT(std::is_sorted(expected_slots.begin(), expected_slots.end()));
+    ASSERT(std::none_of(expected_slots.begin(), expected_slots.end(), [&excluded_slots](int slot) { return excluded_slots.Test(slot); }));
+    for (ScoringKernel kernel : { ScoringKernel::AVX2, ScoringKernel::AVX512 })
+    {
+        // неподдерживаемый набор заменяется лучшим поддерживаемым
+        std::vector<int> matched_slots;
+        CollectMatchedSlots(kernel, is_matched.data(), slot_count, excluded_slots, matched_slots);
+        ASSERT(matched_slots == expected_slots);
+    }
+}
+
+void TestFrozenStringSet()
+{
+    ASSERT(!FrozenStringSet().Contains(""s));
+    ASSERT(!FrozenStringSet().Contains("и"s));
+
+    const FrozenStringSet small(std::vector<std::string>{ "и"s, "в"s, "на"s, "и"s });
+    ASSERT_EQUAL(small.size(), 3u);
+    ASSERT(small.Contains("на"s) && small.Contains("и"s));
+    ASSERT(!small.Contains("н"s) && !small.Contains("нам"s) && !small.Contains(""s));
+
+    // множество из нескольких групп: каждое слово находится, похожие на них - нет
+    std::vector<std::string> words;
+    for (int i = 0; i < 1000; ++i)
+    {
+        words.push_back("w"s + std::to_string(i * 3));
+    }
+    const FrozenStringSet large(words);
+    ASSERT_EQUAL(large.size(), 1000u);
+    for (int i = 0; i < 3000; ++i)
+    {
+        ASSERT_EQUAL_HINT(large.Contains("w"s + std::to_string(i)), i % 3 == 0, std::to_string(i));
+    }
+}
+
+void TestWordFrequencies()
+{
+    SearchServer server("и"s);
+    server.AddDocument(4, "пушистый кот и пушистый хвост"s, DocumentStatus::ACTUAL, {1});
+
+    std::vector<std::pair<std::string, double>> frequencies;
+    for (const auto& [word, freq] : server.GetWordFrequencies(4))
+    {
+        frequencies.emplace_back(word, freq);
+    }
+    // слова идут по возрастанию, стоп-слова не учитываются
+    const std::vector<std::pair<std::string, double>> expected = { {"кот"s, 0.25}, {"пушистый"s, 0.5}, {"хвост"s, 0.25} };
+    ASSERT(frequencies == expected);
+
+    ASSERT(server.GetWordFrequencies(5).empty());
+    server.RemoveDocument(4);
+    ASSERT(server.GetWordFrequencies(4).empty());
+}
+
+void TestAddDocumentsMatchesSequential()
+{
+    std::vector<std::tuple<int, std::string, DocumentStatus, std::vector<int>>> batch;
+    for (int id = 0; id < 1000; ++id)
+    {
+        const CorpusDocument document = MakeCorpusDocument(id, 3);
+        batch.emplace_back(id + 100, document.text, document.status, document.ratings);
+    }
+
+    // освобождённые слоты должны переиспользоваться в том же порядке, что и при поочерёдном добавлении
+    SearchServer sequential("and0 and1"s);
+    SearchServer batched("and0 and1"s);
+    for (SearchServer* server : { &sequential, &batched })
+    {
+        server->SetThreadCount(4);
+        for (int id = 0; id < 10; ++id)
+        {
+            server->AddDocument(id, "white cat"s + std::to_string(id), DocumentStatus::ACTUAL, {id});
+        }
+        server->RemoveDocument(3);
+        server->RemoveDocument(7);
+    }
+
+    for (const auto& [id, text, status, ratings] : batch)
+    {
+        sequential.AddDocument(id, text, status, ratings);
+    }
+    batched.AddDocuments(std::execution::par, batch);
+
+    ASSERT_EQUAL(batched.GetDocumentCount(), sequential.GetDocumentCount());
+    ASSERT_EQUAL(batched.GetIndexMemoryUsage(), sequential.GetIndexMemoryUsage());
+    for (const std::string& query : { "cat0"s, "curly1 dog0 -tail2"s, "white cat"s, "eyes0 hat1 nasty2 -big0"s })
+    {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT })
+        {
+            const auto expected = sequential.FindTopDocuments(query, status, 50);
+            const auto found = batched.FindTopDocuments(query, status, 50);
+            ASSERT_EQUAL_HINT(found.size(), expected.size(), query);
+            for (size_t i = 0; i < found.size(); ++i)
+            {
+                ASSERT_EQUAL_HINT(found[i].id, expected[i].id, query);
+                ASSERT_EQUAL_HINT(found[i].relevance, expected[i].relevance, query);
+                ASSERT_EQUAL_HINT(found[i].rating, expected[i].rating, query);
+            }
+        }
+    }
+    for (const int id : { 5, 100, 555, 1099 })
+    {
+        const auto expected = sequential.GetWordFrequencies(id);
+        const auto found = batched.GetWordFrequencies(id);
+        ASSERT(std::equal(found.begin(), found.end(), expected.begin(), expected.end()));
+    }
+
+    // некорректный документ в пакете: не добавляется ничего
+    const std::vector<std::tuple<int, std::string, DocumentStatus, std::vector<int>>> invalid_batch = {
+        { 2000, "big dog"s, DocumentStatus::ACTUAL, {1} },
+        { 2001, "big d\x12og"s, DocumentStatus::ACTUAL, {1} },
+    };
+    try
+    {
+        batched.AddDocuments(invalid_batch);
+        ASSERT(false);
+    }
+    catch (const std::invalid_argument&)
+    {
+    }
+    ASSERT_EQUAL(batched.GetDocumentCount(), sequential.GetDocumentCount());
+    ASSERT(batched.GetWordFrequencies(2000).empty());
+}
+
+void TestTokenizerKernels()
+{
+    std::vector<std::string_view> words;
+    ASSERT(SplitIntoValidWords("  пушистый кот  и\tхвост "s, words) == "и\tхвост"s);
+    const std::string text = "  пушистый кот  и хвост "s;
+    ASSERT(SplitIntoValidWords(text, words).empty());
+    ASSERT((words == std::vector<std::string_view>{ "пушистый", "кот", "и", "хвост" }));
+    ASSERT(SplitIntoValidWords(""s, words).empty() && words.empty());
+
+    // тексты длиннее нескольких блоков, с пробелами и управляющими символами на границах блоков
+    const std::string alphabet = "ab  \xd0\xba";
+    for (size_t length : { 15u, 16u, 17u, 31u, 32u, 33u, 100u, 257u })
+    {
+        for (size_t seed = 0; seed < 20; ++seed)
+        {
+            std::string text;
+            for (size_t i = 0; i < length; ++i)
+            {
+                text += alphabet[(i * 7 + seed * 13 + i * i * seed) % alphabet.size()];
+            }
+            if (seed % 4 == 3)
+            {
+                text[(seed * 11) % length] = static_cast<char>(seed % 32);
+            }
+
+            std::vector<std::string_view> expected;
+            const std::string_view expected_invalid = SplitIntoValidWords(TokenizerKernel::SCALAR, text, expected);
+            for (TokenizerKernel kernel : { TokenizerKernel::SSE2, TokenizerKernel::AVX2 })
+            {
+                ASSERT(SplitIntoValidWords(kernel, text, words) == expected_invalid);
+                if (expected_invalid.empty())
+                {
+                    ASSERT_HINT(words == expected, text);
+                }
+            }
+            if (expected_invalid.empty())
+            {
+                ASSERT(SplitIntoWords(text) == expected);
+            }
+        }
+    }
+}
+
+void TestSnapshotMatchesServer()
+{
+    SearchServer server("and with"s);
+    for (int id = 0; id < 700; ++id)
+    {
+        const CorpusDocument document = MakeCorpusDocument(id);
+        server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    for (int id = 0; id < 700; id += 13)
+    {
+        server.RemoveDocument(id);
+    }
+
+    const std::string path = "search_server_test.snapshot"s;
+    for (const PostingCodec codec : { PostingCodec::PLAIN, PostingCodec::VARINT })
+    {
+        server.SetPostingCodec(codec);
+        server.SaveSnapshot(path);
+        const MappedSearchServer mapped(path);
+        ASSERT_EQUAL(mapped.GetDocumentCount(), server.GetDocumentCount());
+
+        for (const std::string& query : CORPUS_QUERIES)
+        {
+            const auto expected = server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 30);
+            const auto found = mapped.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 30);
+            ASSERT_EQUAL_HINT(found.size(), expected.size(), query);
+            for (size_t i = 0; i < found.size(); ++i)
+            {
+                ASSERT_EQUAL_HINT(found[i].id, expected[i].id, query);
+                ASSERT_EQUAL_HINT(found[i].relevance, expected[i].relevance, query);
+                ASSERT_EQUAL_HINT(found[i].rating, expected[i].rating, query);
+            }
+            ASSERT_EQUAL_HINT(mapped.FindTopDocuments(query, IsSelectedCorpusDocument).size(),
+                              server.FindTopDocuments(query, IsSelectedCorpusDocument).size(), query);
+
+            for (const int id : { 1, 2, 14, 699 })
+            {
+                ASSERT(mapped.MatchDocument(query, id) == server.MatchDocument(query, id));
+            }
+        }
+        try
+        {
+            mapped.MatchDocument("cat"s, 13);
+            ASSERT(false);
+        }
+        catch (const std::out_of_range&)
+        {
+        }
+    }
+
+    // повреждённый снимок не открывается: ссылки внутрь секций проверяются при открытии
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    snapshot::Header header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    const auto expect_corrupted = [&bytes, &path](uint64_t position, const auto& value)
+    {
+        std::string corrupted = bytes;
+        std::memcpy(corrupted.data() + position, &value, sizeof(value));
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out << corrupted;
+        }
+        try
+        {
+            MappedSearchServer mapped(path);
+            ASSERT(false);
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+    };
+    const uint64_t term = header.terms.offset;
+    const uint64_t block = header.blocks.offset + sizeof(PostingList::BlockInfo);
+    expect_corrupted(term + offsetof(snapshot::Term, word), snapshot::StringRef{ header.chars.count, 1 });
+    expect_corrupted(term + offsetof(snapshot::Term, first_block), header.blocks.count);
+    expect_corrupted(term + offsetof(snapshot::Term, bytes_offset), header.posting_bytes.count + 1);
+    expect_corrupted(block + offsetof(PostingList::BlockInfo, offset), static_cast<uint32_t>(header.posting_bytes.count));
+    expect_corrupted(block + offsetof(PostingList::BlockInfo, first_slot), static_cast<int>(header.slot_document_ids.count));
+    expect_corrupted(block + offsetof(PostingList::BlockInfo, first_slot), -1);
+    expect_corrupted(header.documents.offset + offsetof(snapshot::DocumentSlot, slot), static_cast<int32_t>(header.slot_document_ids.count));
+    expect_corrupted(offsetof(snapshot::Header, posting_bytes) + offsetof(snapshot::Section, count), uint64_t{1});
+    expect_corrupted(offsetof(snapshot::Header, slot_ratings) + offsetof(snapshot::Section, offset), static_cast<uint64_t>(bytes.size()));
+
+    // файл другого формата не открывается
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << std::string(sizeof(snapshot::Header), 'x');
+    }
+    try
+    {
+        MappedSearchServer mapped(path);
+        ASSERT(false);
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+    std::remove(path.c_str());
+}
+
+void TestRequestQueueCache()
+{
+    SearchServer server("и в на"s);
+    server.AddDocument(0, "белый кот и модный ошейник"s,        DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(1, "пушистый кот пушистый хвост"s,       DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::BANNED, {5, -12, 2, 1});
+
+    RequestQueue queue(server, 2);
+    const auto found = queue.AddFindRequest("пушистый кот -ошейник"s);
+    // порядок слов, повторы и стоп-слова не меняют ключ
+    const auto cached = queue.AddFindRequest("-ошейник кот и пушистый кот"s);
+    ASSERT_EQUAL(cached.size(), 1u);
+    ASSERT_EQUAL(cached[0].id, found[0].id);
+    ASSERT_EQUAL(cached[0].relevance, found[0].relevance);
+    ASSERT_EQUAL(queue.GetCacheStats().hits, 1u);
+    ASSERT_EQUAL(queue.GetCacheStats().misses, 1u);
+
+    // статус входит в ключ
+    ASSERT_EQUAL(queue.AddFindRequest("пушистый кот -ошейник"s, DocumentStatus::BANNED).size(), 0u);
+    ASSERT_EQUAL(queue.AddFindRequest("пёс"s, DocumentStatus::BANNED).size(), 1u);
+    ASSERT_EQUAL(queue.GetCacheStats().misses, 3u);
+
+    // вытеснен самый давно использованный результат
+    queue.AddFindRequest("кот -ошейник пушистый"s);
+    ASSERT_EQUAL(queue.GetCacheStats().misses, 4u);
+
+    // изменение индекса сбрасывает кэш
+    server.AddDocument(3, "пушистый кот"s, DocumentStatus::ACTUAL, {1});
+    const auto refreshed = queue.AddFindRequest("пушистый кот -ошейник"s);
+    ASSERT_EQUAL(refreshed.size(), 2u);
+    ASSERT_EQUAL(queue.GetCacheStats().invalidations, 1u);
+    server.RemoveDocument(3);
+    ASSERT_EQUAL(queue.AddFindRequest("пушистый кот -ошейник"s).size(), 1u);
+    ASSERT_EQUAL(queue.GetCacheStats().invalidations, 2u);
+
+    queue.AddFindRequest("кот"s, [](int document_id, DocumentStatus, int) { return document_id == 0; });
+    ASSERT_EQUAL(queue.GetCacheStats().bypassed, 1u);
+    ASSERT_EQUAL(queue.GetNoResultRequests(), 1);
+}
+
+void TestBatchQueriesMatchSingle()
+{
+    SearchServer server("and0 and1"s);
+    for (int id = 0; id < 3000; ++id)
+    {
+        const CorpusDocument document = MakeCorpusDocument(id, 2);
+        server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    server.SetThreadCount(3);
+
+    const std::vector<std::string> queries = { "cat0"s, "curly1 dog0 -tail0"s, "cat0 white1 cat0 -dog1"s, "unknown"s, ""s,
+                                               "eyes0 hat1 nasty0 big1 -curly0 -cat1"s, "-cat0"s, "white1 cat0"s };
+    const auto batch = server.FindTopDocumentsBatch(queries, DocumentStatus::IRRELEVANT, 20);
+    ASSERT_EQUAL(batch.size(), queries.size());
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+        const auto expected = server.FindTopDocuments(queries[i], DocumentStatus::IRRELEVANT, 20);
+        ASSERT_EQUAL_HINT(batch[i].size(), expected.size(), queries[i]);
+        for (size_t j = 0; j < expected.size(); ++j)
+        {
+            ASSERT_EQUAL_HINT(batch[i][j].id, expected[j].id, queries[i]);
+            ASSERT_EQUAL_HINT(batch[i][j].relevance, expected[j].relevance, queries[i]);
+        }
+    }
+    ASSERT_EQUAL(ProcessQueries(server, queries)[1].size(), server.FindTopDocuments(queries[1]).size());
+}
+
+void TestJoinedQueriesKeepQueryOrder()
+{
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.AddDocument(3, "big cat nasty hair"s, DocumentStatus::ACTUAL, {1, 2, 8});
+    server.AddDocument(4, "big dog cat Vladislav"s, DocumentStatus::ACTUAL, {1, 3, 2});
+    server.AddDocument(5, "big dog hamster Borya"s, DocumentStatus::ACTUAL, {1, 1, 1});
+
+    const std::vector<std::string> queries = { "nasty rat -not"s, "unknown"s, "not very funny nasty pet"s, "curly hair"s, ""s };
+    std::vector<int> expected_ids;
+    for (const std::string& query : queries)
+    {
+        for (const Document& document : server.FindTopDocuments(query))
+        {
+            expected_ids.push_back(document.id);
+        }
+    }
+
+    std::vector<int> joined_ids;
+    for (const Document& document : ProcessQueriesJoined(server, queries))
+    {
+        joined_ids.push_back(document.id);
+    }
+    ASSERT(joined_ids == expected_ids);
+
+    // запросы без результатов пропускаются, окно предвыборки не влияет на порядок
+    for (const size_t prefetch : {1u, 2u, 16u})
+    {
+        QueryResultStream stream(server, queries, prefetch);
+        std::vector<int> streamed_ids;
+        for (const Document& document : stream)
+        {
+            streamed_ids.push_back(document.id);
+        }
+        ASSERT(streamed_ids == expected_ids);
+    }
+
+    const std::vector<std::string> empty_queries = { "unknown"s, ""s };
+    ASSERT(ProcessQueriesJoined(server, empty_queries).empty());
+    QueryResultStream empty_stream(server, empty_queries);
+    ASSERT(empty_stream.begin() == empty_stream.end());
+}
+
+void TestTopDocumentsCount()
+{
+    SearchServer server;
+    for (int id = 0; id < 20; ++id)
+    {
+        server.AddDocument(id, "cat "s + std::to_string(id), DocumentStatus::ACTUAL, {id});
+    }
+
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+
+    const auto found_docs = server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 7);
+    ASSERT_EQUAL(found_docs.size(), 7u);
+    // при равной релевантности документы упорядочены по рейтингу
+    for (size_t i = 0; i < found_docs.size(); ++i)
+    {
+        ASSERT_EQUAL(found_docs[i].id, 19 - static_cast<int>(i));
+    }
+
+    const auto found_docs_par = server.FindTopDocuments(std::execution::par, "cat"s, DocumentStatus::ACTUAL, 7);
+    ASSERT_EQUAL(found_docs_par.size(), 7u);
+    ASSERT_EQUAL(found_docs_par.back().id, 13);
+    ASSERT(server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 0).empty());
+}
+
+void TestPrunedSearchMatchesExhaustive()
+{
+    SearchServer server("and with"s);
+    // документов больше, чем слотов в одном окне; редкое слово оставляет частые термы несущественными
+    for (int id = 0; id < 5000; ++id)
+    {
+        CorpusDocument document = MakeCorpusDocument(id);
+        if (id % 97 == 0)
+        {
+            document.text += "rare"s;
+        }
+        server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+
+    std::vector<std::string> queries = CORPUS_QUERIES;
+    queries.push_back("rare cat dog"s);
+    queries.push_back("cat rare -tail curly"s);
+    for (const PostingCodec codec : { PostingCodec::PLAIN, PostingCodec::VARINT })
+    {
+        server.SetPostingCodec(codec);
+        for (const std::string& query : queries)
+        {
+            for (const size_t top_k : { 1u, 5u, 20u })
+            {
+                PruningStats stats;
+                const auto pruned = server.FindTopDocumentsPruned(query, DocumentStatus::ACTUAL, top_k, &stats);
+                const auto exhaustive = server.FindTopDocuments(query, DocumentStatus::ACTUAL, top_k);
+                ASSERT_EQUAL_HINT(pruned.size(), exhaustive.size(), query);
+                for (size_t i = 0; i < pruned.size(); ++i)
+                {
+                    ASSERT_EQUAL_HINT(pruned[i].id, exhaustive[i].id, query);
+                    ASSERT_EQUAL_HINT(pruned[i].relevance, exhaustive[i].relevance, query);
+                }
+
+                const auto pruned_by_predicate = server.FindTopDocumentsPruned(query, IsSelectedCorpusDocument, top_k);
+                const auto exhaustive_by_predicate = server.FindTopDocuments(query, IsSelectedCorpusDocument, top_k);
+                ASSERT_EQUAL_HINT(pruned_by_predicate.size(), exhaustive_by_predicate.size(), query);
+                for (size_t i = 0; i < pruned_by_predicate.size(); ++i)
+                {
+                    ASSERT_EQUAL_HINT(pruned_by_predicate[i].id, exhaustive_by_predicate[i].id, query);
+                }
+            }
+        }
+
+        // частые термы ищутся только у документов с редким словом
+        PruningStats stats;
+        server.FindTopDocumentsPruned("rare cat dog"s, DocumentStatus::ACTUAL, 1, &stats);
+        ASSERT(stats.postings_skipped > stats.postings_scored);
+    }
+}
+
+void TestImpactSearchMatchesExhaustive()
+{
+    SearchServer server("and with"s);
+    try
+    {
+        server.FindTopDocumentsByImpact("cat"s);
+        ASSERT_HINT(false, "impact search without impact-ordered postings must throw"s);
+    }
+    catch (const std::logic_error&)
+    {
+    }
+
+    // списки строятся по уже добавленным документам и дальше поддерживаются при добавлении и удалении
+    for (int id = 0; id < 300; ++id)
+    {
+        if (id == 150)
+        {
+            server.SetImpactOrderedPostings(true);
+        }
+        const CorpusDocument document = MakeCorpusDocument(id);
+        server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    for (int id = 0; id < 300; id += 13)
+    {
+        server.RemoveDocument(id);
+    }
+
+    for (const std::string& query : CORPUS_QUERIES)
+    {
+        for (const size_t top_k : { 1u, 5u, 20u })
+        {
+            ImpactSearchStats stats;
+            const auto by_impact = server.FindTopDocumentsByImpact(query, DocumentStatus::ACTUAL, top_k, NO_POSTINGS_BUDGET, &stats);
+            const auto exhaustive = server.FindTopDocuments(query, DocumentStatus::ACTUAL, top_k);
+            ASSERT_HINT(stats.is_exact, query);
+            ASSERT_EQUAL_HINT(by_impact.size(), exhaustive.size(), query);
+            for (size_t i = 0; i < by_impact.size(); ++i)
+            {
+                ASSERT_EQUAL_HINT(by_impact[i].relevance, exhaustive[i].relevance, query);
+                ASSERT_EQUAL_HINT(by_impact[i].rating, exhaustive[i].rating, query);
+            }
+
+            const auto by_impact_with_predicate = server.FindTopDocumentsByImpact(query, IsSelectedCorpusDocument, top_k);
+            const auto exhaustive_with_predicate = server.FindTopDocuments(query, IsSelectedCorpusDocument, top_k);
+            ASSERT_EQUAL_HINT(by_impact_with_predicate.size(), exhaustive_with_predicate.size(), query);
+            for (size_t i = 0; i < by_impact_with_predicate.size(); ++i)
+            {
+                ASSERT_EQUAL_HINT(by_impact_with_predicate[i].relevance, exhaustive_with_predicate[i].relevance, query);
+            }
+
+            // с бюджетом результат приближённый, но релевантность найденных документов точная
+            ImpactSearchStats budget_stats;
+            const auto anytime = server.FindTopDocumentsByImpact(query, DocumentStatus::ACTUAL, top_k, 10, &budget_stats);
+            ASSERT(budget_stats.postings_scored <= 10u);
+            ASSERT(anytime.size() <= top_k);
+            for (const Document& document : anytime)
+            {
+                const auto single = server.FindTopDocuments(query, [&document](int document_id, DocumentStatus, int)
+                {
+                    return document_id == document.id;
+                });
+                ASSERT_EQUAL_HINT(single.size(), 1u, query);
+                ASSERT_EQUAL_HINT(single[0].relevance, document.relevance, query);
+            }
+        }
+    }
+}
+
+void TestShardedServerMatchesSingle()
+{
+    SearchServer server("and with"s);
+    ShardedSearchServer sharded_server(3, "and with"s);
+    for (int id = 0; id < 200; ++id)
+    {
+        const CorpusDocument document = MakeCorpusDocument(id);
+        server.AddDocument(document.id, document.text, document.status, document.ratings);
+        sharded_server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    for (int id = 0; id < 200; id += 7)
+    {
+        server.RemoveDocument(id);
+        sharded_server.RemoveDocument(id);
+    }
+    ASSERT_EQUAL(sharded_server.GetDocumentCount(), server.GetDocumentCount());
+    ASSERT_EQUAL(sharded_server.GetShardCount(), 3u);
+
+    std::vector<std::string> queries = CORPUS_QUERIES;
+    queries.push_back("and"s);
+    for (const std::string& query : queries)
+    {
+        // IDF считается по всем шардам, поэтому релевантность совпадает бит в бит
+        const auto expected = server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 20);
+        const auto found = sharded_server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 20);
+        ASSERT_EQUAL_HINT(found.size(), expected.size(), query);
+        for (size_t i = 0; i < found.size(); ++i)
+        {
+            ASSERT_EQUAL_HINT(found[i].relevance, expected[i].relevance, query);
+            ASSERT_EQUAL_HINT(found[i].rating, expected[i].rating, query);
+        }
+
+        const auto expected_with_predicate = server.FindTopDocuments(query, IsSelectedCorpusDocument);
+        const auto found_with_predicate = sharded_server.FindTopDocuments(query, IsSelectedCorpusDocument);
+        ASSERT_EQUAL_HINT(found_with_predicate.size(), expected_with_predicate.size(), query);
+        for (size_t i = 0; i < found_with_predicate.size(); ++i)
+        {
+            ASSERT_EQUAL_HINT(found_with_predicate[i].relevance, expected_with_predicate[i].relevance, query);
+        }
+    }
+
+    // найденные слова ссылаются на строку запроса, поэтому она должна жить дольше результата
+    const std::string match_query = "curly dog cat"s;
+    const auto [words_matched, status] = sharded_server.MatchDocument(match_query, 5);
+    const auto [expected_words, expected_status] = server.MatchDocument(match_query, 5);
+    ASSERT(words_matched == expected_words);
+    ASSERT(status == expected_status);
+}
+
+void TestConcurrentServerReadersDuringWrites()
+{
+    ConcurrentSearchServer server(4, "and with"s);
+    SearchServer expected_server("and with"s);
+    const auto make_text = [](int id)
+    {
+        return "common and word"s + std::to_string(id % 17) + " tag"s + std::to_string(id % 5);
+    };
+
+    std::atomic<bool> is_writing = true;
+    std::atomic<size_t> inconsistent_snapshots = 0;
+    std::atomic<size_t> snapshot_count = 0;
+    const auto read = [&]
+    {
+        uint64_t last_generation = 0;
+        while (is_writing)
+        {
+            // все документы содержат "common", поэтому в согласованном снимке поиск находит каждый из них
+            const ConcurrentSearchServer::Snapshot snapshot = server.GetSnapshot();
+            const auto found_docs = snapshot.FindTopDocuments("common -nothing"s, DocumentStatus::ACTUAL, 1'000'000);
+            if (found_docs.size() != snapshot.GetDocumentCount() || snapshot.GetGeneration() < last_generation)
+            {
+                ++inconsistent_snapshots;
+            }
+            last_generation = snapshot.GetGeneration();
+            server.FindTopDocuments("word3 tag1"s);
+            ++snapshot_count;
+        }
+    };
+    std::vector<std::future<void>> readers;
+    for (int i = 0; i < 3; ++i)
+    {
+        readers.push_back(std::async(std::launch::async, read));
+    }
+
+    for (int id = 0; id < 300; ++id)
+    {
+        server.AddDocument(id, make_text(id), DocumentStatus::ACTUAL, {id % 7});
+        expected_server.AddDocument(id, make_text(id), DocumentStatus::ACTUAL, {id % 7});
+        if (id % 3 == 0)
+        {
+            server.RemoveDocument(id / 2);
+            expected_server.RemoveDocument(id / 2);
+        }
+    }
+    std::vector<std::tuple<int, std::string, DocumentStatus, std::vector<int>>> batch;
+    for (int id = 300; id < 400; ++id)
+    {
+        batch.emplace_back(id, make_text(id), DocumentStatus::ACTUAL, std::vector<int>{id % 7});
+        expected_server.AddDocument(id, make_text(id), DocumentStatus::ACTUAL, {id % 7});
+    }
+    server.AddDocuments(batch);
+    is_writing = false;
+    for (auto& reader : readers)
+    {
+        reader.get();
+    }
+
+    ASSERT_EQUAL(inconsistent_snapshots.load(), 0u);
+    ASSERT(snapshot_count.load() > 0);
+    ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+    for (const std::string& query : { "common"s, "word3 tag1"s, "tag4 -word2"s })
+    {
+        const auto found_docs = server.FindTopDocuments(query, DocumentStatus::ACTUAL, 10);
+        const auto expected_docs = expected_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 10);
+        ASSERT_EQUAL_HINT(found_docs.size(), expected_docs.size(), query);
+        for (size_t i = 0; i < found_docs.size(); ++i)
+        {
+            ASSERT_EQUAL_HINT(found_docs[i].relevance, expected_docs[i].relevance, query);
+            ASSERT_EQUAL_HINT(found_docs[i].rating, expected_docs[i].rating, query);
+        }
+    }
+
+    // удаление отсутствующего документа не публикует поколения, неудачное добавление - тоже
+    const uint64_t generation = server.GetGeneration();
+    server.RemoveDocument(100'000);
+    try
+    {
+        server.AddDocument(2, "duplicate"s, DocumentStatus::ACTUAL, {});
+    }
+    catch (const std::invalid_argument&)
+    {
+    }
+    ASSERT_EQUAL(server.GetGeneration(), generation);
+    server.RemoveDocuments(std::vector<int>{ 100'000, 100'001 });
+    ASSERT_EQUAL(server.GetGeneration(), generation);
+    // пакет удалений публикуется одним поколением, отсутствующие id пропускаются
+    const size_t document_count = server.GetDocumentCount();
+    server.RemoveDocuments(std::vector<int>{ 300, 301, 100'000, 305 });
+    ASSERT_EQUAL(server.GetGeneration(), generation + 1);
+    ASSERT_EQUAL(server.GetDocumentCount(), document_count - 3);
+    // без читателей отложенные поколения освобождаются при следующей публикации
+    server.AddDocument(1'000, "common"s, DocumentStatus::ACTUAL, {});
+    ASSERT_EQUAL(server.GetRetiredGenerationCount(), 0u);
+}
+
+void TestSegmentedServerMatchesSingle()
+{
+    // маленький сегмент записи: за время теста сегменты много раз замораживаются и сливаются
+    SegmentedSearchServer server("and with"s, 8);
+    SearchServer expected_server("and with"s);
+    const auto check = [&](const std::string& hint)
+    {
+        ASSERT_EQUAL_HINT(server.GetDocumentCount(), expected_server.GetDocumentCount(), hint);
+        for (const std::string& query : CORPUS_QUERIES)
+        {
+            const auto found_docs = server.FindTopDocuments(query, DocumentStatus::ACTUAL, 20);
+            const auto expected_docs = expected_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 20);
+            ASSERT_EQUAL_HINT(found_docs.size(), expected_docs.size(), hint + ": "s + query);
+            for (size_t i = 0; i < found_docs.size(); ++i)
+            {
+                ASSERT_EQUAL_HINT(found_docs[i].relevance, expected_docs[i].relevance, hint + ": "s + query);
+                ASSERT_EQUAL_HINT(found_docs[i].rating, expected_docs[i].rating, hint + ": "s + query);
+            }
+        }
+    };
+
+    for (int id = 0; id < 400; ++id)
+    {
+        const CorpusDocument document = MakeCorpusDocument(id);
+        server.AddDocument(document.id, document.text, document.status, document.ratings);
+        expected_server.AddDocument(document.id, document.text, document.status, document.ratings);
+        if (id % 5 == 4)
+        {
+            server.RemoveDocument(id * 3 / 5);
+            expected_server.RemoveDocument(id * 3 / 5);
+        }
+        if (id % 50 == 0)
+        {
+            // поиск и удаления идут одновременно с фоновым слиянием
+            check("during merges"s);
+        }
+    }
+    ASSERT(server.GetTombstoneCount() > 0 || server.GetSegmentCount() > 1);
+
+    server.Flush();
+    server.WaitForMerges();
+    check("after merges"s);
+    ASSERT(server.GetSegmentCount() < 400 / 8);
+
+    // повторное добавление удалённого id и повторное удаление
+    server.RemoveDocument(3);
+    expected_server.RemoveDocument(3);
+    server.AddDocument(3, "curly cat"s, DocumentStatus::ACTUAL, {9});
+    expected_server.AddDocument(3, "curly cat"s, DocumentStatus::ACTUAL, {9});
+    check("re-added"s);
+    ASSERT_EQUAL(std::get<0>(server.MatchDocument("curly -dog"s, 3)).size(), 1u);
+    try
+    {
+        server.AddDocument(3, "duplicate"s, DocumentStatus::ACTUAL, {});
+        ASSERT_HINT(false, "duplicate id across segments must throw"s);
+    }
+    catch (const std::invalid_argument&)
+    {
+    }
+
+    // перенос с повторяющимся id не добавляет ни одного документа
+    SearchServer target("and with"s);
+    target.AddDocument(3, "curly cat"s, DocumentStatus::ACTUAL, {1});
+    try
+    {
+        target.AddDocumentsFrom(expected_server, [](int)
+        {
+            return true;
+        });
+        ASSERT_HINT(false, "transfer of an existing id must throw"s);
+    }
+    catch (const std::invalid_argument&)
+    {
+    }
+    ASSERT_EQUAL(target.GetDocumentCount(), 1u);
+    ASSERT_EQUAL(target.FindTopDocuments("cat"s).size(), 1u);
+}
+
+void TestPostingListCodecs()
+{
+    for (const PostingCodec codec : { PostingCodec::PLAIN, PostingCodec::VARINT })
+    {
+        PostingList postings(codec);
+        std::map<int, uint32_t> expected;
+        // вставки в конец, в середину сжатых блоков и удаления
+        for (int slot = 0; slot < 2000; slot += 3)
+        {
+            postings.Add(slot, slot % 5 + 1, 0.0);
+            expected[slot] = slot % 5 + 1;
+        }
+        for (int slot = 1; slot < 2000; slot += 7)
+        {
+            postings.Add(slot, 1000, 0.0);
+            expected[slot] += 1000;
+        }
+        for (int slot = 0; slot < 2000; slot += 11)
+        {
+            ASSERT_EQUAL(postings.Remove(slot), expected.erase(slot) > 0);
+        }
+        postings.SetCodec(codec == PostingCodec::PLAIN ? PostingCodec::VARINT : PostingCodec::PLAIN);
+        postings.Add(5000, 2, 0.0);
+        expected[5000] = 2;
+
+        ASSERT_EQUAL(postings.size(), expected.size());
+        auto it = expected.begin();
+        for (PostingList::Cursor cursor(postings); !cursor.AtEnd(); cursor.Next(), ++it)
+        {
+            ASSERT_EQUAL(cursor.Slot(), it->first);
+            ASSERT_EQUAL(cursor.Count(), it->second);
+        }
+        ASSERT(it == expected.end());
+
+        PostingList::Cursor cursor(postings);
+        cursor.Seek(1500);
+        ASSERT_EQUAL(cursor.Slot(), expected.lower_bound(1500)->first);
+        ASSERT(postings.Contains(1501) == (expected.count(1501) > 0));
+        ASSERT(!postings.Contains(1999));
+
+        // байты заменённых блоков вычищаются, и многократные изменения внутри блока не раздувают буфер
+        const size_t memory_usage = postings.GetMemoryUsage();
+        for (int round = 0; round < 1000; ++round)
+        {
+            postings.Add(1000, 1, 0.0);
+            ASSERT(postings.Remove(1000));
+        }
+        ASSERT(postings.GetMemoryUsage() <= 4 * memory_usage);
+        it = expected.begin();
+        for (PostingList::Cursor updated_cursor(postings); !updated_cursor.AtEnd(); updated_cursor.Next(), ++it)
+        {
+            ASSERT_EQUAL(updated_cursor.Slot(), it->first);
+            ASSERT_EQUAL(updated_cursor.Count(), it->second);
+        }
+        ASSERT(it == expected.end());
+    }
+}
+
+void TestStatusAndMinusWordExclusion()
+{
+    SearchServer server;
+    server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "black cat"s, DocumentStatus::BANNED, {2});
+    server.AddDocument(3, "cat with collar"s, DocumentStatus::ACTUAL, {3});
+
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s, DocumentStatus::BANNED).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("cat -collar"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("cat -collar"s).at(0).id, 1);
+    ASSERT(server.FindTopDocuments("cat -white -collar"s).empty());
+
+    // слот удалённого документа переиспользуется документом с другим статусом
+    server.RemoveDocument(2);
+    ASSERT(server.FindTopDocuments("black"s, DocumentStatus::BANNED).empty());
+    server.AddDocument(4, "black dog"s, DocumentStatus::IRRELEVANT, {4});
+    ASSERT(server.FindTopDocuments("black"s, DocumentStatus::BANNED).empty());
+    ASSERT_EQUAL(server.FindTopDocuments("black"s, DocumentStatus::IRRELEVANT).at(0).id, 4);
+    ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, "black"s, DocumentStatus::IRRELEVANT).at(0).id, 4);
+
+    // исключение по статусу и минус-словам совпадает с фильтром предикатом, в том числе в параллельной версии
+    SearchServer large;
+    for (int id = 0; id < 5000; ++id)
+    {
+        large.AddDocument(id, "w"s + std::to_string(id % 7) + " w"s + std::to_string(id % 11) + " w"s + std::to_string(id % 13),
+                          static_cast<DocumentStatus>(id % 3), {id % 10});
+    }
+    for (int id = 0; id < 5000; id += 17)
+    {
+        large.RemoveDocument(id);
+    }
+    large.SetThreadCount(4);
+    for (const std::string& query : { "w1 w2 w3 -w4"s, "w5 w6 -w0 -w7"s, "w1 w2 w3 w4 w5 w6 w7 w8 w9 w10 w11 w12"s, "-w1 -w2"s })
+    {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED })
+        {
+            const auto by_predicate = large.FindTopDocuments(query, [status]([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating)
+            {
+                return document_status == status;
+            }, 1000);
+            const auto by_status = large.FindTopDocuments(query, status, 1000);
+            const auto by_status_par = large.FindTopDocuments(std::execution::par, query, status, 1000);
+            ASSERT_EQUAL(by_status.size(), by_predicate.size());
+            ASSERT_EQUAL(by_status_par.size(), by_predicate.size());
+            for (size_t i = 0; i < by_predicate.size(); ++i)
+            {
+                ASSERT_EQUAL(by_status[i].id, by_predicate[i].id);
+                ASSERT_EQUAL(by_status[i].relevance, by_predicate[i].relevance);
+                ASSERT_EQUAL(by_status_par[i].id, by_predicate[i].id);
+                ASSERT_EQUAL(by_status_par[i].relevance, by_predicate[i].relevance);
+            }
+        }
+    }
+}
+
+void TestRecognizedPredicatesMatchLambdas()
+{
+    SearchServer server;
+    for (int id = 0; id < 3000; ++id)
+    {
+        server.AddDocument(id, "w"s + std::to_string(id % 5) + " w"s + std::to_string(id % 9) + " w"s + std::to_string(id % 14),
+                           static_cast<DocumentStatus>(id % 4), {id % 21 - 10});
+    }
+    for (int id = 0; id < 3000; id += 13)
+    {
+        server.RemoveDocument(id);
+    }
+    server.SetThreadCount(3);
+
+    const auto check = [&server](const auto& indexed_predicate)
+    {
+        const auto lambda = [&indexed_predicate](int document_id, DocumentStatus status, int rating)
+        {
+            return indexed_predicate(document_id, status, rating);
+        };
+        for (const std::string& query : { "w1 w2 w3"s, "w4 w5 w6 -w0"s, "w7 w8 w9 w10 w11 w12 w13 -w3 -w2"s })
+        {
+            const auto expected = server.FindTopDocuments(query, lambda, 3000);
+            const auto found = server.FindTopDocuments(query, indexed_predicate, 3000);
+            const auto found_par = server.FindTopDocuments(std::execution::par, query, indexed_predicate, 3000);
+            ASSERT_EQUAL(found.size(), expected.size());
+            ASSERT_EQUAL(found_par.size(), expected.size());
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                ASSERT_EQUAL(found[i].id, expected[i].id);
+                ASSERT_EQUAL(found[i].relevance, expected[i].relevance);
+                ASSERT_EQUAL(found_par[i].id, expected[i].id);
+                ASSERT_EQUAL(found_par[i].relevance, expected[i].relevance);
+            }
+        }
+    };
+
+    check(StatusIs{ DocumentStatus::BANNED });
+    check(RatingBetween{ -3, 4 });
+    check(RatingBetween{ 5, -5 });
+    check(DocumentIdBetween{ 100, 1234 });
+    check(DocumentIdBetween{ 2990, 5000 });
+    check(StatusIs{ DocumentStatus::ACTUAL } && RatingBetween{ 0, 10 });
+    check(StatusIs{ DocumentStatus::IRRELEVANT } && RatingBetween{ -10, 0 } && DocumentIdBetween{ 500, 2500 });
+
+    ASSERT(IsRecognizedPredicate<decltype(StatusIs{ DocumentStatus::ACTUAL } && DocumentIdBetween{ 0, 1 })>::value);
+    ASSERT(!IsRecognizedPredicate<decltype(check)>::value);
+}
+
+void TestQueryContextDoesNotAllocate()
+{
+    SearchServer server("and with"s);
+    for (int id = 0; id < 2000; ++id)
+    {
+        server.AddDocument(id, "w"s + std::to_string(id % 7) + " and w"s + std::to_string(id % 11) + " w"s + std::to_string(id % 17),
+                           static_cast<DocumentStatus>(id % 3), {id % 9 - 4});
+    }
+
+    const std::vector<std::string> queries = { "w1 w2 w3"s, "w4 and w5 w6 -w0"s, "w7 w8 w9 w10 w11 w12 w13 -w3 -w2"s, "w16 w16 -w15"s };
+    const auto lambda = [](int document_id, [[maybe_unused]] DocumentStatus status, int rating)
+    {
+        return document_id % 2 == 0 && rating > 0;
+    };
+    QueryContext context;
+    const auto search_all = [&]
+    {
+        for (const std::string& query : queries)
+        {
+            server.FindTopDocuments(context, query);
+            server.FindTopDocuments(context, query, StatusIs{ DocumentStatus::BANNED } && RatingBetween{ -2, 2 }, 100);
+            server.FindTopDocuments(context, query, lambda, 2000);
+        }
+    };
+    // первые запросы доращивают буферы контекста, дальше память не выделяется
+    search_all();
+    search_all();
+    ASSERT_EQUAL(CountAllocations(search_all), 0u);
+
+    for (const std::string& query : queries)
+    {
+        const std::vector<Document> expected = server.FindTopDocuments(query, lambda, 2000);
+        const std::vector<Document>& found = server.FindTopDocuments(context, query, lambda, 2000);
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT_EQUAL(found[i].relevance, expected[i].relevance);
+        }
+    }
+
+    // поиск из предиката другого поиска получает свой контекст потока
+    const auto nested = [&server](int document_id, [[maybe_unused]] DocumentStatus status, [[maybe_unused]] int rating)
+    {
+        return !server.FindTopDocuments("w3 w5"s, DocumentIdBetween{ document_id, document_id }).empty();
+    };
+    const std::vector<Document> expected = server.FindTopDocuments("w1 w2"s, [](int document_id, DocumentStatus, int)
+    {
+        return document_id % 7 == 3 || document_id % 7 == 5 || document_id % 11 == 3 || document_id % 11 == 5
+            || document_id % 17 == 3 || document_id % 17 == 5;
+    }, 2000);
+    const std::vector<Document> found = server.FindTopDocuments("w1 w2"s, nested, 2000);
+    ASSERT_EQUAL(found.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        ASSERT_EQUAL(found[i].id, expected[i].id);
+    }
+
+    // контекст потока удерживает буферы запросов, пока они не больше предела
+    ASSERT(context.GetMemoryUsage() >= server.GetDocumentCount() * sizeof(double));
+    server.FindTopDocuments("w1"s);
+    {
+        ThreadQueryContext thread_context;
+        ASSERT(thread_context.Get().GetMemoryUsage() >= server.GetDocumentCount() * sizeof(double));
+        ASSERT(thread_context.Get().GetMemoryUsage() <= ThreadQueryContext::MAX_RETAINED_BYTES);
+    }
+}
+
+void TestBm25Ranking()
+{
+    SearchServer server("and"s);
+    server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(2, "cat cat dog bird"s, DocumentStatus::ACTUAL, { 2 });
+    server.AddDocument(3, "dog and bird fish fish fish"s, DocumentStatus::ACTUAL, { 3 });
+    server.AddDocument(4, "cat fish"s, DocumentStatus::BANNED, { 4 });
+    server.AddDocument(5, "parrot parrot parrot parrot parrot parrot parrot"s, DocumentStatus::ACTUAL, { 5 });
+    server.RemoveDocument(5);
+
+    // длины без стоп-слов: 1, 4, 5, 2; средняя - 3
+    const double average_length = 3.0;
+    const auto bm25 = [average_length](int count, int length, int document_freq)
+    {
+        const double inverse_document_freq = std::log(1.0 + (4 - document_freq + 0.5) / (document_freq + 0.5));
+        const double length_norm = Bm25Ranking::K1 * (1.0 - Bm25Ranking::B + Bm25Ranking::B * length / average_length);
+        return inverse_document_freq * count * (Bm25Ranking::K1 + 1.0) / (count + length_norm);
+    };
+
+    {
+        const auto found = server.FindTopDocuments<Bm25Ranking>("cat"s);
+        ASSERT_EQUAL(found.size(), 2u);
+        // короткий документ с одним вхождением выше длинного с двумя
+        ASSERT_EQUAL(found[0].id, 1);
+        ASSERT_EQUAL(found[1].id, 2);
+        ASSERT(std::abs(found[0].relevance - bm25(1, 1, 3)) < 1e-12);
+        ASSERT(std::abs(found[1].relevance - bm25(2, 4, 3)) < 1e-12);
+    }
+    {
+        const auto found = server.FindTopDocuments<Bm25Ranking>("fish -dog"s, DocumentStatus::BANNED);
+        ASSERT_EQUAL(found.size(), 1u);
+        ASSERT_EQUAL(found[0].id, 4);
+        ASSERT(std::abs(found[0].relevance - bm25(1, 2, 2)) < 1e-12);
+    }
+
+    // явная модель TF-IDF совпадает с поиском по умолчанию, в том числе через контекст
+    QueryContext context;
+    for (const std::string& query : { "cat dog"s, "bird fish -cat"s, "cat fish bird"s })
+    {
+        const auto expected = server.FindTopDocuments(query, [](int, DocumentStatus, int) { return true; });
+        const auto found = server.FindTopDocuments<TfIdfRanking>(query, [](int, DocumentStatus, int) { return true; });
+        const auto found_bm25 = server.FindTopDocuments<Bm25Ranking>(query, RatingBetween{ 0, 10 });
+        const std::vector<Document>& found_in_context = server.FindTopDocuments<Bm25Ranking>(context, query, RatingBetween{ 0, 10 });
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT_EQUAL(found[i].relevance, expected[i].relevance);
+        }
+        ASSERT_EQUAL(found_in_context.size(), found_bm25.size());
+        for (size_t i = 0; i < found_bm25.size(); ++i)
+        {
+            ASSERT_EQUAL(found_in_context[i].id, found_bm25[i].id);
+            ASSERT_EQUAL(found_in_context[i].relevance, found_bm25[i].relevance);
+        }
+    }
+}
+
+void TestSearchServer()
+{
+    RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
+    RUN_TEST(TestMatchingDocuments);
+    RUN_TEST(TestAverageRating);
+    RUN_TEST(TestPredicateFilter);
+    RUN_TEST(TestCorrectRelevanceCount);
+    RUN_TEST(TestRemoveDocument);
+    RUN_TEST(TestConcurrentMapMatchesMap);
+    RUN_TEST(TestConcurrentMapConcurrentAccess);
+    RUN_TEST(TestTokenizerKernels);
+    RUN_TEST(TestScoringKernels);
+    RUN_TEST(TestFrozenStringSet);
+    RUN_TEST(TestInverseDocumentFreqFollowsIndexChanges);
+    RUN_TEST(TestWordFrequencies);
+    RUN_TEST(TestAddDocumentsMatchesSequential);
+    RUN_TEST(TestSnapshotMatchesServer);
+    RUN_TEST(TestRequestQueueCache);
+    RUN_TEST(TestBatchQueriesMatchSingle);
+    RUN_TEST(TestJoinedQueriesKeepQueryOrder);
+    RUN_TEST(TestTopDocumentsCount);
+    RUN_TEST(TestPrunedSearchMatchesExhaustive);
+    RUN_TEST(TestImpactSearchMatchesExhaustive);
+    RUN_TEST(TestShardedServerMatchesSingle);
+    RUN_TEST(TestConcurrentServerReadersDuringWrites);
+    RUN_TEST(TestSegmentedServerMatchesSingle);
+    RUN_TEST(TestPostingListCodecs);
+    RUN_TEST(TestStatusAndMinusWordExclusion);
+    RUN_TEST(TestRecognizedPredicatesMatchLambdas);
+    RUN_TEST(TestQueryContextDoesNotAllocate);
+    RUN_TEST(TestBm25Ranking);
+}
@@ -4,10 +4,29 @@
 #include "document.h"
 //#include "remove_duplicates.h"
 #include "search_server.h"
+#include "concurrent_map.h"
+#include "index_snapshot.h"
+#include "request_queue.h"
+#include "process_queries.h"
+#include "sharded_search_server.h"
+#include "concurrent_search_server.h"
+#include "segmented_search_server.h"
 
+#include <atomic>
+#include <future>
 #include <vector>
 #include <string>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <new>
+#include <random>
 #include <tuple>
 
 using std::string_literals::operator""s;
@@ -0,0 +1,127 @@
+#include "top_documents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <thread>
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs)
+{
+    if (std::abs(lhs.relevance - rhs.relevance) < EPSILON)
+    {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+//--------------------TopDocumentsHeap------------------//
+TopDocumentsHeap::TopDocumentsHeap(size_t capacity)
+    : capacity_(capacity)
+{
+    heap_.reserve(capacity);
+}
+
+TopDocumentsHeap::TopDocumentsHeap(size_t capacity, std::vector<Document>&& buffer)
+    : capacity_(capacity), heap_(std::move(buffer))
+{
+    heap_.clear();
+    heap_.reserve(capacity);
+}
+
+void TopDocumentsHeap::Push(const Document& document)
+{
+    if (heap_.size() < capacity_)
+    {
+        heap_.push_back(document);
+        std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    }
+    else if (capacity_ > 0 && IsMoreRelevant(document, heap_.front()))
+    {
+        std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        heap_.back() = document;
+        std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    }
+}
+
+bool TopDocumentsHeap::IsFull() const
+{
+    return heap_.size() == capacity_;
+}
+
+const Document& TopDocumentsHeap::GetWorst() const
+{
+    return heap_.front();
+}
+
+std::vector<Document> TopDocumentsHeap::Extract()
+{
+    std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    return std::move(heap_);
+}
+
+//--------------------SelectTopDocuments------------------//
+void SelectTopDocuments(std::vector<Document>& documents, size_t top_k)
+{
+    TopDocumentsHeap heap(std::min(top_k, documents.size()));
+    for (const Document& document : documents)
+    {
+        heap.Push(document);
+    }
+    documents = heap.Extract();
+}
+
+void SelectTopDocuments(std::vector<Document>& documents, size_t top_k, std::vector<Document>& buffer)
+{
+    TopDocumentsHeap heap(std::min(top_k, documents.size()), std::move(buffer));
+    for (const Document& document : documents)
+    {
+        heap.Push(document);
+    }
+    // отобранные копируются обратно, а не переносятся, чтобы каждый вектор сохранил свою ёмкость
+    buffer = heap.Extract();
+    documents.assign(buffer.begin(), buffer.end());
+}
+
+void SelectTopDocuments(const std::execution::sequenced_policy&, std::vector<Document>& documents, size_t top_k)
+{
+    SelectTopDocuments(documents, top_k);
+}
+
+void SelectTopDocuments(const std::execution::parallel_policy&, std::vector<Document>& documents, size_t top_k)
+{
+    // на маленьких выборках запуск потоков дороже самого отбора
+    const size_t min_chunk_size = 4096;
+    const size_t chunk_count = std::min<size_t>(std::thread::hardware_concurrency(), documents.size() / min_chunk_size);
+    if (chunk_count <= 1)
+    {
+        SelectTopDocuments(documents, top_k);
+        return;
+    }
+
+    // каждый поток отбирает top_k в своём куске, затем лучшие из кусков сливаются в одну кучу
+    const size_t chunk_size = (documents.size() + chunk_count - 1) / chunk_count;
+    std::vector<std::future<std::vector<Document>>> chunk_tops;
+    for (size_t begin = 0; begin < documents.size(); begin += chunk_size)
+    {
+        const size_t end = std::min(begin + chunk_size, documents.size());
+        chunk_tops.push_back(std::async(std::launch::async, [&documents, begin, end, top_k]
+        {
+            TopDocumentsHeap heap(top_k);
+            for (size_t i = begin; i < end; ++i)
+            {
+                heap.Push(documents[i]);
+            }
+            return heap.Extract();
+        }));
+    }
+
+    TopDocumentsHeap heap(std::min(top_k, documents.size()));
+    for (auto& chunk_top : chunk_tops)
+    {
+        for (const Document& document : chunk_top.get())
+        {
+            heap.Push(document);
+        }
+    }
+    documents = heap.Extract();
+}
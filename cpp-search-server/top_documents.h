@@ -0,0 +1,35 @@
+#pragma once
+#include "document.h"
+
+#include <execution>
+#include <vector>
+
+const double EPSILON = 1e-6;
+
+// Сначала по релевантности, при равной (с точностью EPSILON) релевантности - по рейтингу.
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+// Ограниченная куча из не более чем capacity лучших документов. На вершине - худший из отобранных.
+class TopDocumentsHeap
+{
+private:
+    size_t capacity_;
+    std::vector<Document> heap_;
+
+public:
+    explicit TopDocumentsHeap(size_t capacity);
+    // куча строится в памяти buffer; если её ёмкость не меньше capacity, память не выделяется
+    TopDocumentsHeap(size_t capacity, std::vector<Document>&& buffer);
+
+    void Push(const Document& document);
+    bool IsFull() const;
+    const Document& GetWorst() const;
+    std::vector<Document> Extract();
+};
+
+// Оставляет в documents top_k лучших документов, упорядоченных по IsMoreRelevant.
+void SelectTopDocuments(std::vector<Document>& documents, size_t top_k);
+// То же с кучей в buffer: ёмкость documents и buffer сохраняется, и при повторных вызовах память не выделяется.
+void SelectTopDocuments(std::vector<Document>& documents, size_t top_k, std::vector<Document>& buffer);
+void SelectTopDocuments(const std::execution::sequenced_policy&, std::vector<Document>& documents, size_t top_k);
+void SelectTopDocuments(const std::execution::parallel_policy&, std::vector<Document>& documents, size_t top_k);